@@ -6,13 +6,71 @@
 
 #define reg(name) (z80->reg.cur->name)
 
+/* Opcode dispatch
+ *
+ * With Z80E_COMPUTED_GOTO defined and a compiler that supports the GCC
+ * labels-as-values extension, every `case` also carries a label whose address
+ * is stored in a per-dispatcher jump table, and op_dispatch jumps straight to
+ * the handler instead of going through the switch compare chain. Opcodes
+ * without a handler fall through to the `default:` label. Without the
+ * extension everything compiles down to the portable switch.
+ */
+#if defined(Z80E_COMPUTED_GOTO) && (defined(__GNUC__) || defined(__clang__))
+#define Z80E_USE_COMPUTED_GOTO
+#endif
+
+#ifdef Z80E_USE_COMPUTED_GOTO
+#define op_case(op)                                                                                                    \
+  l_##op:                                                                                                              \
+  case op:
+#define op_default                                                                                                     \
+  l_default:                                                                                                           \
+  default:
+#define op_target(op) [op] = &&l_##op
+#define op_dispatch(table, opcode)                                                                                     \
+  do {                                                                                                                 \
+    void* _target = (table)[opcode];                                                                                   \
+    goto*(_target ? _target : &&l_default);                                                                            \
+  } while (0)
+#else
+#define op_case(op) case op:
+#define op_default default:
+#define op_dispatch(table, opcode)
+#endif
+
+/* Profile counters compile out entirely without Z80E_PROFILE */
+#ifdef Z80E_PROFILE
+#define profile_count(counter, index) (++z80->profile.counter[index])
+#else
+#define profile_count(counter, index)
+#endif
+
+/* The trace ring compiles out entirely without Z80E_TRACE; while compiled in
+ * but disabled the record lands in the scratch slot, so there is no enable
+ * branch on the dispatch path */
+#ifdef Z80E_TRACE
+#define trace_step(op)                                                                                                 \
+  do {                                                                                                                 \
+    z80e_trace_record* rec = &z80->trace.buf[z80->trace.pos++ & z80->trace.mask];                                      \
+    rec->cycle = z80->tstates;                                                                                         \
+    rec->pc = z80->reg.pc - 1;                                                                                         \
+    rec->af = reg(af);                                                                                                 \
+    rec->hl = reg(hl);                                                                                                 \
+    rec->sp = z80->reg.sp;                                                                                             \
+    rec->opcode = (op);                                                                                                \
+  } while (0)
+#else
+#define trace_step(op)
+#endif
+
 #define bit(v, n) (((v) & (1 << n)) != 0)
 #define low_nibble(v) (v & 0x0f)
 #define high_nibble(v) (v >> 4)
 #define lsb(v) (v & 0xff)
 #define msb(v) (v >> 8)
 
-static zi8 z80e_execute(z80e* z80, zu8 opcode);
+static zi32 z80e_execute(z80e* z80, zu8 opcode);
+static zi32 interrupt_accept(z80e* z80);
 
 static void dec8(z80e* z80, zu8* reg);
 static void inc8(z80e* z80, zu8* reg);
@@ -37,13 +95,13 @@ static void push(z80e* z80, zu16 rr);
 static zu16 pop(z80e* z80);
 
 static zu8 ldi(z80e* z80);
-static zu8 ldir(z80e* z80);
+static zi32 ldir(z80e* z80);
 static zu8 ldd(z80e* z80);
-static zu8 lddr(z80e* z80);
+static zi32 lddr(z80e* z80);
 static zu8 cpi(z80e* z80);
-static zu8 cpir(z80e* z80);
+static zi32 cpir(z80e* z80);
 static zu8 cpd(z80e* z80);
-static zu8 cpdr(z80e* z80);
+static zi32 cpdr(z80e* z80);
 static void rld(z80e* z80);
 static void rrd(z80e* z80);
 
@@ -85,10 +143,10 @@ zu8 ret(z80e* z80, zu8 cc);
 
 /* ini or ind depending on mode */
 static void in_id(z80e* z80, int mode);
-static zi8 inr(z80e* z80, int mode);
+static zi32 inr(z80e* z80, int mode);
 /* outi or outd depending on mode */
 static void out_id(z80e* z80, int mode);
-static zi8 outr(z80e* z80, int mode);
+static zi32 outr(z80e* z80, int mode);
 
 static zu8 is_even_parity(zu8 v);
 
@@ -117,6 +175,21 @@ static inline void set_f(z80e* z80, zu8 v, zu8 pos) {
   }
 }
 
+/* Precomputed flag tables
+ *
+ * szyx_table holds the S, Z, Y and X bits for every result byte,
+ * parity_table the P/V bit. inc_flags/dec_flags hold the whole F register
+ * for INC r/DEC r, indexed by the value *before* the operation. The tables
+ * let the byte-wide ALU helpers compose F with one or two loads instead of
+ * eight read-modify-write chains; they are filled on the first z80e_init.
+ */
+static zu8 szyx_table[256];
+static zu8 parity_table[256];
+static zu8 inc_flags[256];
+static zu8 dec_flags[256];
+
+static void init_flag_tables(void);
+
 static inline void set_sf(z80e* z80, zu8 v) { set_f(z80, v, 7); }
 static inline void set_zf(z80e* z80, zu8 v) { set_f(z80, v, 6); }
 static inline void set_yf(z80e* z80, zu8 v) { set_f(z80, v, 5); }
@@ -189,16 +262,17 @@ static zu16 read_word(z80e* z80);
 static zu16 read_word_at(z80e* z80, zu16 addr);
 static void write_byte(z80e* z80, zu8 byte);
 static void write_byte_at(z80e* z80, zu8 byte, zu16 addr);
+static void store_byte(z80e* z80, zu8 byte, zu16 addr);
 static void write_word(z80e* z80, zu16 word);
 static void write_word_at(z80e* z80, zu16 word, zu16 addr);
 static zu8 io_read_byte(z80e* z80, zu8 port, zu8 byte);
 static void io_write_byte(z80e* z80, zu8 port, zu8 msb, zu8 byte);
 
-static inline zu16 bc(z80e* z80) { return (reg(b) << 8) | reg(c); }
-static inline zu16 hl(z80e* z80) { return (reg(h) << 8) | reg(l); }
-static inline zu16 de(z80e* z80) { return (reg(d) << 8) | reg(e); }
+static inline zu16 bc(z80e* z80) { return reg(bc); }
+static inline zu16 hl(z80e* z80) { return reg(hl); }
+static inline zu16 de(z80e* z80) { return reg(de); }
 static inline zu16 sp(z80e* z80) { return z80->reg.sp; }
-static inline zu16 af(z80e* z80) { return (reg(a) << 8) | reg(f); }
+static inline zu16 af(z80e* z80) { return reg(af); }
 
 static void set_bc(z80e* z80, zu16 val);
 static void set_hl(z80e* z80, zu16 val);
@@ -206,11 +280,32 @@ static void set_de(z80e* z80, zu16 val);
 static void set_sp(z80e* z80, zu16 val);
 static void set_af(z80e* z80, zu16 val);
 
-static zi8 z80e_execute_cb(z80e* z80, zu8 opcode, zu16 addr, int with_iz);
-static zi8 z80e_execute_ed(z80e* z80, zu8 opcode);
-static zi8 z80e_execute_ddfd(z80e* z80, zu16* rr, zu8 opcode);
+static zi32 z80e_execute_cb(z80e* z80, zu8 opcode, zu16 addr, int with_iz);
+static zi32 z80e_execute_ed(z80e* z80, zu8 opcode);
+static zi32 z80e_execute_ddfd(z80e* z80, zu16* rr, zu8 opcode);
+
+static void init_flag_tables(void) {
+  static int done = 0;
+  if (done) {
+    return;
+  }
+  done = 1;
+
+  for (zu32 v = 0; v < 0x100; ++v) {
+    szyx_table[v] = (v & 0xa8) | (v == 0 ? 0x40 : 0);
+    parity_table[v] = is_even_parity(v) ? 0x04 : 0;
+  }
+
+  for (zu32 v = 0; v < 0x100; ++v) {
+    /* inc8/dec8 derive P/V from the carry; bit 0 is CF, bit 2 is P/V */
+    inc_flags[v] = szyx_table[(zu8)(v + 1)] | (u8_half_carry(v, 1) << 4) | (u8_overflow(v, 1) ? 0x05 : 0);
+    dec_flags[v] = szyx_table[(zu8)(v - 1)] | (u8_half_borrow(v, 1) << 4) | (borrow(8, v, 1, 0) ? 0x05 : 0) | 0x02;
+  }
+}
 
 void z80e_init(z80e* z80, z80e_config* config) {
+  init_flag_tables();
+
   for (zu32 i = 0; i < sizeof(*z80); ++i) {
     ((zu8*)z80)[i] = 0;
   }
@@ -220,317 +315,847 @@ void z80e_init(z80e* z80, z80e_config* config) {
   z80->ioread = config->ioread;
   z80->iowrite = config->iowrite;
   z80->ctx = config->ctx;
+  z80->mem = config->mem;
+  z80->pcache_enabled = config->predecode && config->mem == 0;
 
   z80->reg.cur = &z80->reg.main;
+
+  /* All pages dirty: the first checkpoint is a full capture */
+  for (zu32 i = 0; i < sizeof(z80->dirty); ++i) {
+    z80->dirty[i] = 0xff;
+  }
+
+#ifdef Z80E_TRACE
+  z80->trace.buf = &z80->trace.scratch;
+#endif
 }
 
-zi8 z80e_instruction(z80e* z80) {
+/* Look up the predecode cache before an opcode fetch. On a hit the whole
+ * instruction is replayed from the entry; on a miss the entry starts
+ * recording the bytes the instruction fetches. */
+static void predecode_begin(z80e* z80) {
+  z80e_predecode_entry* entry;
+
+  if (!z80->pcache_enabled) {
+    return;
+  }
+
+  entry = &z80->pcache[z80->reg.pc & 0xff];
+  if (entry->valid && entry->pc == z80->reg.pc) {
+    z80->pd_serve = entry;
+    z80->pd_fill = 0;
+    z80->pd_pos = 0;
+  } else {
+    entry->valid = 1;
+    entry->pc = z80->reg.pc;
+    entry->len = 0;
+    z80->pd_fill = entry;
+    z80->pd_serve = 0;
+  }
+}
+
+/* A write may land in the bytes of up to 4 cached instructions */
+static void predecode_invalidate(z80e* z80, zu16 addr) {
+  for (zu8 i = 0; i < 4; ++i) {
+    zu16 pc = addr - i;
+    z80e_predecode_entry* entry = &z80->pcache[pc & 0xff];
+    if (entry->valid && entry->pc == pc) {
+      entry->valid = 0;
+    }
+  }
+}
+
+void z80e_predecode_flush(z80e* z80) {
+  for (zu32 i = 0; i < 256; ++i) {
+    z80->pcache[i].valid = 0;
+  }
+  z80->pd_serve = 0;
+  z80->pd_fill = 0;
+}
+
+zi32 z80e_instruction(z80e* z80) {
   if (z80->error) {
     return z80->error;
   }
 
+  zi32 ack = interrupt_accept(z80);
+  if (ack != 0) {
+    if (ack < 0) {
+      z80->error = ack;
+      return ack;
+    }
+    z80->tstates += ack;
+    return ack;
+  }
+
   if (z80->halt) {
+    z80->tstates += 4;
     return 4;
   }
 
+  profile_count(pc, z80->reg.pc);
+
+  if (z80->iolog) {
+    z80e_save(z80, z80->iolog_undo);
+  }
+
+  predecode_begin(z80);
   zu8 opcode = read_byte(z80);
-  zi8 ret = z80e_execute(z80, opcode);
+  zi32 ret = z80e_execute(z80, opcode);
+  if (z80->error == Z80E_IOLOG_FULL) {
+    /* The IO log ran out mid-instruction: rewind to the snapshot taken
+     * above, so the boundary read re-executes once the host re-arms */
+    z80e_restore(z80, z80->iolog_undo);
+    z80->error = Z80E_IOLOG_FULL;
+    return Z80E_IOLOG_FULL;
+  }
   if (ret < 0) {
     z80->error = ret;
+  } else {
+    z80->tstates += ret;
   }
 
   return ret;
 }
 
+zu32 z80e_run(z80e* z80, zu32 tstates) { return z80e_run_until(z80, z80->tstates + tstates); }
+
+static void run_pending_event(z80e* z80) {
+  if (z80->event_fn && z80->tstates >= z80->event_at) {
+    z80e_event_fn_t fn = z80->event_fn;
+    z80->event_fn = 0;
+    fn(z80, z80->event_ctx);
+  }
+}
+
+zu32 z80e_run_until(z80e* z80, zu64 tstate) {
+  zu32 total = 0;
+
+  run_pending_event(z80);
+
+  while (z80->tstates < tstate && !z80->error) {
+    zi32 ack = interrupt_accept(z80);
+    if (ack != 0) {
+      if (ack < 0) {
+        z80->error = ack;
+        break;
+      }
+      total += ack;
+      z80->tstates += ack;
+      run_pending_event(z80);
+      continue;
+    }
+
+    if (z80->halt) {
+      /* Fast-forward idle time in one step instead of spinning on 4 T-state
+       * halt NOPs, stopping at the next event so it still fires on time. An
+       * event may wake the CPU by clearing `halt`. */
+      zu64 until = tstate;
+      if (z80->event_fn && z80->event_at < until) {
+        until = z80->event_at;
+      }
+      /* Clamp instead of truncating: a gap that is an exact multiple of
+       * 2^32 would truncate to an idle step of zero and spin forever */
+      zu64 gap = until - z80->tstates;
+      zu32 idle = gap > 0xfffffffc ? 0xfffffffc : ((zu32)gap + 3) & ~(zu32)3;
+      total += idle;
+      z80->tstates += idle;
+      run_pending_event(z80);
+      continue;
+    }
+
+    profile_count(pc, z80->reg.pc);
+
+    if (z80->iolog) {
+      z80e_save(z80, z80->iolog_undo);
+    }
+
+    predecode_begin(z80);
+    zu8 opcode = read_byte(z80);
+    zi32 ret = z80e_execute(z80, opcode);
+    if (z80->error == Z80E_IOLOG_FULL) {
+      z80e_restore(z80, z80->iolog_undo);
+      z80->error = Z80E_IOLOG_FULL;
+      break;
+    }
+    if (ret < 0) {
+      z80->error = ret;
+      break;
+    }
+    total += ret;
+    z80->tstates += ret;
+    run_pending_event(z80);
+  }
+
+  return total;
+}
+
+/* Re-arming with a fresh buffer resumes a run stopped at the log boundary */
+static void iolog_clear_full(z80e* z80) {
+  if (z80->error == Z80E_IOLOG_FULL) {
+    z80->error = Z80E_OK;
+  }
+}
+
+void z80e_record(z80e* z80, z80e_io_record* log, zu32 capacity) {
+  z80->iolog = log;
+  z80->iolog_cap = capacity;
+  z80->iolog_pos = 0;
+  z80->iolog_replay = 0;
+  iolog_clear_full(z80);
+}
+
+void z80e_replay(z80e* z80, z80e_io_record const* log, zu32 length) {
+  z80->iolog = (z80e_io_record*)log;
+  z80->iolog_cap = length;
+  z80->iolog_pos = 0;
+  z80->iolog_replay = 1;
+  iolog_clear_full(z80);
+}
+
+zu32 z80e_record_stop(z80e* z80) {
+  zu32 pos = z80->iolog_pos;
+  z80->iolog = 0;
+  iolog_clear_full(z80);
+  return pos;
+}
+
+void z80e_map_rom(z80e* z80, zu16 base, zu32 size, zu8 const* data) {
+  if (size > 0x10000u - base) {
+    size = 0x10000u - base;
+  }
+  z80->rom = data;
+  z80->rom_base = base;
+  z80->rom_size = data ? size : 0;
+}
+
+void z80e_watch(z80e* z80, zu16 base, zu32 len, z80e_watch_fn_t fn, void* ctx) {
+  if (!fn) {
+    for (zu32 i = 0; i < sizeof(z80->watch_mask); ++i) {
+      z80->watch_mask[i] = 0;
+    }
+    z80->watch_fn = 0;
+    z80->watch_ctx = 0;
+    return;
+  }
+  if (len > 0x10000u - base) {
+    len = 0x10000u - base;
+  }
+  for (zu32 i = 0; i < len; ++i) {
+    zu32 addr = base + i;
+    z80->watch_mask[addr >> 3] |= 1 << (addr & 7);
+  }
+  z80->watch_fn = fn;
+  z80->watch_ctx = ctx;
+}
+
+void z80e_map_page(z80e* z80, zu8 first, zu32 count, zu8* data, zu8 flags) {
+  if (count > (zu32)Z80E_PAGE_COUNT - first) {
+    count = (zu32)Z80E_PAGE_COUNT - first;
+  }
+  for (zu32 i = 0; i < count; ++i) {
+    z80->page[first + i].ptr = data ? data + i * Z80E_PAGE_SIZE : 0;
+    z80->page[first + i].flags = flags;
+  }
+}
+
+/* Snapshot fields are written byte by byte in little-endian order, so blobs
+ * are exchangeable between hosts of different byte orders. */
+
+static void snap_put16(zu8** p, zu16 v) {
+  *(*p)++ = v & 0xff;
+  *(*p)++ = v >> 8;
+}
+
+static void snap_put64(zu8** p, zu64 v) {
+  for (int i = 0; i < 8; ++i) {
+    *(*p)++ = (v >> (8 * i)) & 0xff;
+  }
+}
+
+static zu16 snap_get16(zu8 const** p) {
+  zu16 v = (zu16)((*p)[0] | ((*p)[1] << 8));
+  *p += 2;
+  return v;
+}
+
+static zu64 snap_get64(zu8 const** p) {
+  zu64 v = 0;
+  for (int i = 0; i < 8; ++i) {
+    v |= (zu64)(*p)[i] << (8 * i);
+  }
+  *p += 8;
+  return v;
+}
+
+zu32 z80e_save(z80e* z80, zu8* buf) {
+  zu8* p = buf;
+
+  *p++ = 'Z';
+  *p++ = '8';
+  *p++ = '0';
+  *p++ = 'S';
+  *p++ = 1; /* version */
+
+  snap_put16(&p, z80->reg.main.af);
+  snap_put16(&p, z80->reg.main.bc);
+  snap_put16(&p, z80->reg.main.de);
+  snap_put16(&p, z80->reg.main.hl);
+  snap_put16(&p, z80->reg.alt.af);
+  snap_put16(&p, z80->reg.alt.bc);
+  snap_put16(&p, z80->reg.alt.de);
+  snap_put16(&p, z80->reg.alt.hl);
+  *p++ = z80->reg.i;
+  *p++ = z80->reg.r;
+  *p++ = z80->reg.u;
+  snap_put16(&p, z80->reg.ix);
+  snap_put16(&p, z80->reg.iy);
+  snap_put16(&p, z80->reg.sp);
+  snap_put16(&p, z80->reg.pc);
+  *p++ = z80->cur_reg_set;
+  *p++ = z80->halt;
+  *p++ = z80->iff;
+  *p++ = z80->int_mode;
+  snap_put16(&p, z80->state.tmp);
+  snap_put64(&p, z80->tstates);
+
+  return p - buf;
+}
+
+int z80e_restore(z80e* z80, zu8 const* buf) {
+  zu8 const* p = buf;
+
+  if (p[0] != 'Z' || p[1] != '8' || p[2] != '0' || p[3] != 'S' || p[4] != 1) {
+    return -1;
+  }
+  p += 5;
+
+  z80->reg.main.af = snap_get16(&p);
+  z80->reg.main.bc = snap_get16(&p);
+  z80->reg.main.de = snap_get16(&p);
+  z80->reg.main.hl = snap_get16(&p);
+  z80->reg.alt.af = snap_get16(&p);
+  z80->reg.alt.bc = snap_get16(&p);
+  z80->reg.alt.de = snap_get16(&p);
+  z80->reg.alt.hl = snap_get16(&p);
+  z80->reg.i = *p++;
+  z80->reg.r = *p++;
+  z80->reg.u = *p++;
+  z80->reg.ix = snap_get16(&p);
+  z80->reg.iy = snap_get16(&p);
+  z80->reg.sp = snap_get16(&p);
+  z80->reg.pc = snap_get16(&p);
+  z80->cur_reg_set = *p++;
+  z80->halt = *p++;
+  z80->iff = *p++;
+  z80->int_mode = *p++;
+  z80->state.tmp = snap_get16(&p);
+  z80->tstates = snap_get64(&p);
+
+  z80->reg.cur = z80->cur_reg_set == 0 ? &z80->reg.main : &z80->reg.alt;
+  z80->error = Z80E_OK;
+  if (z80->pcache_enabled) {
+    z80e_predecode_flush(z80);
+  }
+
+  return 0;
+}
+
+/* Checkpoint stream: a header of magic, version and page count, the
+ * z80e_save blob, then one record of page index plus contents per dirty
+ * page. All multi-byte fields are little-endian. */
+
+zu32 z80e_checkpoint(z80e* z80, z80e_writer_fn_t writer, void* ctx) {
+  zu8 hdr[7 + Z80E_SNAPSHOT_SIZE];
+  zu8 rec[1 + Z80E_PAGE_SIZE];
+  zu16 count = 0;
+  zu32 total;
+
+  for (zu32 page = 0; page < Z80E_PAGE_COUNT; ++page) {
+    count += (z80->dirty[page >> 3] >> (page & 7)) & 1;
+  }
+
+  hdr[0] = 'Z';
+  hdr[1] = '8';
+  hdr[2] = '0';
+  hdr[3] = 'C';
+  hdr[4] = 1; /* version */
+  hdr[5] = count & 0xff;
+  hdr[6] = count >> 8;
+  z80e_save(z80, hdr + 7);
+  writer(hdr, sizeof(hdr), ctx);
+  total = sizeof(hdr);
+
+  for (zu32 page = 0; page < Z80E_PAGE_COUNT; ++page) {
+    if (!((z80->dirty[page >> 3] >> (page & 7)) & 1)) {
+      continue;
+    }
+    rec[0] = page;
+    for (zu32 i = 0; i < Z80E_PAGE_SIZE; ++i) {
+      rec[1 + i] = read_byte_at(z80, (page << 8) | i);
+    }
+    writer(rec, sizeof(rec), ctx);
+    total += sizeof(rec);
+  }
+
+  for (zu32 i = 0; i < sizeof(z80->dirty); ++i) {
+    z80->dirty[i] = 0;
+  }
+  return total;
+}
+
+int z80e_checkpoint_apply(z80e* z80, zu8 const* data, zu32 len) {
+  zu16 count;
+
+  if (len < 7 + Z80E_SNAPSHOT_SIZE || data[0] != 'Z' || data[1] != '8' || data[2] != '0' || data[3] != 'C' ||
+      data[4] != 1) {
+    return -1;
+  }
+  count = data[5] | (data[6] << 8);
+  if (len < 7 + Z80E_SNAPSHOT_SIZE + count * (zu32)(1 + Z80E_PAGE_SIZE)) {
+    return -1;
+  }
+  if (z80e_restore(z80, data + 7) != 0) {
+    return -1;
+  }
+
+  data += 7 + Z80E_SNAPSHOT_SIZE;
+  for (zu32 i = 0; i < count; ++i) {
+    zu16 base = data[0] << 8;
+    for (zu32 j = 0; j < Z80E_PAGE_SIZE; ++j) {
+      store_byte(z80, data[1 + j], base | j);
+    }
+    data += 1 + Z80E_PAGE_SIZE;
+  }
+  return 0;
+}
+
+#ifdef Z80E_PROFILE
+void z80e_profile_reset(z80e* z80) {
+  for (zu32 i = 0; i < sizeof(z80->profile); ++i) {
+    ((zu8*)&z80->profile)[i] = 0;
+  }
+}
+#endif
+
+#ifdef Z80E_TRACE
+void z80e_trace_enable(z80e* z80, z80e_trace_record* buf, zu32 size) {
+  z80->trace.buf = buf ? buf : &z80->trace.scratch;
+  z80->trace.mask = buf ? size - 1 : 0;
+  z80->trace.pos = 0;
+}
+
+zu32 z80e_trace_dump(z80e* z80, z80e_trace_record* out, zu32 max) {
+  zu32 size = z80->trace.mask + 1;
+  zu32 count = z80->trace.pos < size ? z80->trace.pos : size;
+
+  if (z80->trace.buf == &z80->trace.scratch) {
+    return 0;
+  }
+  if (count > max) {
+    count = max;
+  }
+  for (zu32 i = 0; i < count; ++i) {
+    out[i] = z80->trace.buf[(z80->trace.pos - count + i) & z80->trace.mask];
+  }
+  return count;
+}
+#endif
+
+void z80e_schedule(z80e* z80, zu64 tstate, z80e_event_fn_t fn, void* ctx) {
+  z80->event_at = tstate;
+  z80->event_fn = fn;
+  z80->event_ctx = ctx;
+}
+
+void z80e_int(z80e* z80, zu8 bus_value) {
+  z80->int_pending = 1;
+  z80->int_bus = bus_value;
+}
+
+void z80e_nmi(z80e* z80) { z80->nmi_pending = 1; }
+
+/* Accept a pending interrupt at an instruction boundary
+ *
+ * Returns the T-states of the acknowledge sequence, 0 when nothing is
+ * delivered. NMI wins over INT and ignores iff1; the maskable line stays
+ * pending while interrupts are disabled, like the level-triggered line it
+ * models. Acceptance clears `halt`, waking an idle CPU. */
+static zi32 interrupt_accept(z80e* z80) {
+  if (z80->nmi_pending) {
+    z80->nmi_pending = 0;
+    z80->halt = 0;
+    set_iff1(z80, 0); /* iff2 keeps the pre-interrupt state for retn */
+    push(z80, z80->reg.pc);
+    z80->reg.pc = 0x0066;
+    return 11;
+  }
+  if (z80->ei_shadow) {
+    /* Delayed by one instruction, so a handler's ei; reti runs to
+     * completion before the next acceptance */
+    z80->ei_shadow = 0;
+    return 0;
+  }
+  if (z80->int_pending && iff1(z80)) {
+    z80->int_pending = 0;
+    z80->halt = 0;
+    set_iff1(z80, 0);
+    set_iff2(z80, 0);
+    switch (z80->int_mode) {
+    case 0: {
+      /* The device drives an opcode (normally an rst) onto the bus */
+      zi32 ret = z80e_execute(z80, z80->int_bus);
+      return ret < 0 ? ret : ret + 2;
+    }
+    case 1:
+      push(z80, z80->reg.pc);
+      z80->reg.pc = 0x0038;
+      return 13;
+    default: /* mode 2: the vector table entry selected by i and the bus byte */
+      push(z80, z80->reg.pc);
+      z80->reg.pc = read_word_at(z80, ((zu16)z80->reg.i << 8) | z80->int_bus);
+      return 19;
+    }
+  }
+  return 0;
+}
+
 void z80e_halt(z80e* z80) { z80->halt = 1; }
 
 int z80e_get_halt(z80e* z80) { return z80->halt; }
 
-static zi8 z80e_execute(z80e* z80, zu8 opcode) {
+static zi32 z80e_execute(z80e* z80, zu8 opcode) {
   zu8 tmp8;
   zu16 tmp16;
 
+  profile_count(opcode, opcode);
+  trace_step(opcode);
+
+#ifdef Z80E_USE_COMPUTED_GOTO
+  static void* const op_targets[256] = {
+      op_target(0x78), op_target(0x79), op_target(0x7a), op_target(0x7b), op_target(0x7c), op_target(0x7d), op_target(0x7f),
+      op_target(0x40), op_target(0x41), op_target(0x42), op_target(0x43), op_target(0x44), op_target(0x45), op_target(0x47),
+      op_target(0x48), op_target(0x49), op_target(0x4a), op_target(0x4b), op_target(0x4c), op_target(0x4d), op_target(0x4f),
+      op_target(0x50), op_target(0x51), op_target(0x52), op_target(0x53), op_target(0x54), op_target(0x55), op_target(0x57),
+      op_target(0x58), op_target(0x59), op_target(0x5a), op_target(0x5b), op_target(0x5c), op_target(0x5d), op_target(0x5f),
+      op_target(0x60), op_target(0x61), op_target(0x62), op_target(0x63), op_target(0x64), op_target(0x65), op_target(0x67),
+      op_target(0x68), op_target(0x69), op_target(0x6a), op_target(0x6b), op_target(0x6c), op_target(0x6d), op_target(0x6f),
+      op_target(0x3e), op_target(0x06), op_target(0x0e), op_target(0x16), op_target(0x1e), op_target(0x26), op_target(0x2e),
+      op_target(0x7e), op_target(0x46), op_target(0x4e), op_target(0x56), op_target(0x5e), op_target(0x66), op_target(0x6e),
+      op_target(0x70), op_target(0x71), op_target(0x72), op_target(0x73), op_target(0x74), op_target(0x75), op_target(0x77),
+      op_target(0x36), op_target(0x0a), op_target(0x1a), op_target(0x3a), op_target(0x02), op_target(0x12), op_target(0x32),
+      op_target(0x01), op_target(0x11), op_target(0x21), op_target(0x31), op_target(0x2a), op_target(0x22), op_target(0xf9),
+      op_target(0xc5), op_target(0xd5), op_target(0xe5), op_target(0xf5), op_target(0xc1), op_target(0xd1), op_target(0xe1),
+      op_target(0xf1), op_target(0x04), op_target(0x0c), op_target(0x14), op_target(0x1c), op_target(0x24), op_target(0x2c),
+      op_target(0x3c), op_target(0x05), op_target(0x0d), op_target(0x15), op_target(0x1d), op_target(0x25), op_target(0x2d),
+      op_target(0x3d), op_target(0x80), op_target(0x81), op_target(0x82), op_target(0x83), op_target(0x84), op_target(0x85),
+      op_target(0x87), op_target(0xc6), op_target(0x86), op_target(0x88), op_target(0x89), op_target(0x8a), op_target(0x8b),
+      op_target(0x8c), op_target(0x8d), op_target(0x8f), op_target(0xce), op_target(0x8e), op_target(0x90), op_target(0x91),
+      op_target(0x92), op_target(0x93), op_target(0x94), op_target(0x95), op_target(0x97), op_target(0xd6), op_target(0x96),
+      op_target(0x98), op_target(0x99), op_target(0x9a), op_target(0x9b), op_target(0x9c), op_target(0x9d), op_target(0x9f),
+      op_target(0xde), op_target(0x9e), op_target(0xa0), op_target(0xa1), op_target(0xa2), op_target(0xa3), op_target(0xa4),
+      op_target(0xa5), op_target(0xa7), op_target(0xe6), op_target(0xa6), op_target(0xb0), op_target(0xb1), op_target(0xb2),
+      op_target(0xb3), op_target(0xb4), op_target(0xb5), op_target(0xb7), op_target(0xf6), op_target(0xb6), op_target(0xa8),
+      op_target(0xa9), op_target(0xaa), op_target(0xab), op_target(0xac), op_target(0xad), op_target(0xaf), op_target(0xee),
+      op_target(0xae), op_target(0xb8), op_target(0xb9), op_target(0xba), op_target(0xbb), op_target(0xbc), op_target(0xbd),
+      op_target(0xbf), op_target(0xfe), op_target(0xbe), op_target(0x29), op_target(0x39), op_target(0x19), op_target(0x09),
+      op_target(0x03), op_target(0x13), op_target(0x23), op_target(0x33), op_target(0x0b), op_target(0x1b), op_target(0x2b),
+      op_target(0x3b), op_target(0xc3), op_target(0xc2), op_target(0xca), op_target(0xd2), op_target(0xda), op_target(0xe2),
+      op_target(0xea), op_target(0xf2), op_target(0xfa), op_target(0xe9), op_target(0x18), op_target(0x28), op_target(0x20),
+      op_target(0x38), op_target(0x30), op_target(0x10), op_target(0x27), op_target(0x2f), op_target(0x3f), op_target(0x37),
+      op_target(0x00), op_target(0x76), op_target(0xf3), op_target(0xfb), op_target(0xcd), op_target(0xc4), op_target(0xcc),
+      op_target(0xd4), op_target(0xdc), op_target(0xe4), op_target(0xec), op_target(0xf4), op_target(0xfc), op_target(0xc9),
+      op_target(0xc0), op_target(0xc8), op_target(0xd0), op_target(0xd8), op_target(0xe0), op_target(0xe8), op_target(0xf0),
+      op_target(0xf8), op_target(0xc7), op_target(0xcf), op_target(0xd7), op_target(0xdf), op_target(0xe7), op_target(0xef),
+      op_target(0xf7), op_target(0xff), op_target(0xdb), op_target(0xd3), op_target(0x07), op_target(0x0f), op_target(0xeb),
+      op_target(0x08), op_target(0xd9), op_target(0xe3), op_target(0x17), op_target(0x1f), op_target(0x34), op_target(0x35),
+      op_target(0xcb), op_target(0xed), op_target(0xdd), op_target(0xfd),
+  };
+#endif
+
+  op_dispatch(op_targets, opcode);
+
   switch (opcode) {
     /* clang-format off */
-  case 0x78: reg(a) = reg(b); return 4; /* ld a, b */
-  case 0x79: reg(a) = reg(c); return 4; /* ld a, c */
-  case 0x7a: reg(a) = reg(d); return 4; /* ld a, d */
-  case 0x7b: reg(a) = reg(e); return 4; /* ld a, e */
-  case 0x7c: reg(a) = reg(h); return 4; /* ld a, h */
-  case 0x7d: reg(a) = reg(l); return 4; /* ld a, l */
-  case 0x7f: reg(a) = reg(a); return 4; /* ld a, a */
-
-  case 0x40: reg(b) = reg(b); return 4; /* ld b, b */
-  case 0x41: reg(b) = reg(c); return 4; /* ld b, c */
-  case 0x42: reg(b) = reg(d); return 4; /* ld b, d */
-  case 0x43: reg(b) = reg(e); return 4; /* ld b, e */
-  case 0x44: reg(b) = reg(h); return 4; /* ld b, h */
-  case 0x45: reg(b) = reg(l); return 4; /* ld b, l */
-  case 0x47: reg(b) = reg(a); return 4; /* ld b, a */
-
-  case 0x48: reg(c) = reg(b); return 4; /* ld c, b */
-  case 0x49: reg(c) = reg(c); return 4; /* ld c, c */
-  case 0x4a: reg(c) = reg(d); return 4; /* ld c, d */
-  case 0x4b: reg(c) = reg(e); return 4; /* ld c, e */
-  case 0x4c: reg(c) = reg(h); return 4; /* ld c, h */
-  case 0x4d: reg(c) = reg(l); return 4; /* ld c, l */
-  case 0x4f: reg(c) = reg(a); return 4; /* ld c, a */
-
-  case 0x50: reg(d) = reg(b); return 4; /* ld d, b */
-  case 0x51: reg(d) = reg(c); return 4; /* ld d, c */
-  case 0x52: reg(d) = reg(d); return 4; /* ld d, d */
-  case 0x53: reg(d) = reg(e); return 4; /* ld d, e */
-  case 0x54: reg(d) = reg(h); return 4; /* ld d, h */
-  case 0x55: reg(d) = reg(l); return 4; /* ld d, l */
-  case 0x57: reg(d) = reg(a); return 4; /* ld d, a */
-
-  case 0x58: reg(e) = reg(b); return 4; /* ld e, b */
-  case 0x59: reg(e) = reg(c); return 4; /* ld e, c */
-  case 0x5a: reg(e) = reg(d); return 4; /* ld e, d */
-  case 0x5b: reg(e) = reg(e); return 4; /* ld e, e */
-  case 0x5c: reg(e) = reg(h); return 4; /* ld e, h */
-  case 0x5d: reg(e) = reg(l); return 4; /* ld e, l */
-  case 0x5f: reg(e) = reg(a); return 4; /* ld e, a */
-
-  case 0x60: reg(h) = reg(b); return 4; /* ld h, b */
-  case 0x61: reg(h) = reg(c); return 4; /* ld h, c */
-  case 0x62: reg(h) = reg(d); return 4; /* ld h, d */
-  case 0x63: reg(h) = reg(e); return 4; /* ld h, e */
-  case 0x64: reg(h) = reg(h); return 4; /* ld h, h */
-  case 0x65: reg(h) = reg(l); return 4; /* ld h, l */
-  case 0x67: reg(h) = reg(a); return 4; /* ld h, a */
-
-  case 0x68: reg(l) = reg(b); return 4; /* ld l, b */
-  case 0x69: reg(l) = reg(c); return 4; /* ld l, c */
-  case 0x6a: reg(l) = reg(d); return 4; /* ld l, d */
-  case 0x6b: reg(l) = reg(e); return 4; /* ld l, e */
-  case 0x6c: reg(l) = reg(h); return 4; /* ld l, h */
-  case 0x6d: reg(l) = reg(l); return 4; /* ld l, l */
-  case 0x6f: reg(l) = reg(a); return 4; /* ld l, a */
-
-  case 0x3e: reg(a) = read_byte(z80); return 7; /* ld a, n */
-  case 0x06: reg(b) = read_byte(z80); return 7; /* ld b, n */
-  case 0x0e: reg(c) = read_byte(z80); return 7; /* ld c, n */
-  case 0x16: reg(d) = read_byte(z80); return 7; /* ld d, n */
-  case 0x1e: reg(e) = read_byte(z80); return 7; /* ld e, n */
-  case 0x26: reg(h) = read_byte(z80); return 7; /* ld h, n */
-  case 0x2e: reg(l) = read_byte(z80); return 7; /* ld l, n */
-
-  case 0x7e: reg(a) = read_byte_at(z80, hl(z80)); return 7; /* ld a, (hl) */
-  case 0x46: reg(b) = read_byte_at(z80, hl(z80)); return 7; /* ld b, (hl) */
-  case 0x4e: reg(c) = read_byte_at(z80, hl(z80)); return 7; /* ld c, (hl) */
-  case 0x56: reg(d) = read_byte_at(z80, hl(z80)); return 7; /* ld d, (hl) */
-  case 0x5e: reg(e) = read_byte_at(z80, hl(z80)); return 6; /* ld e, (hl) */
-  case 0x66: reg(h) = read_byte_at(z80, hl(z80)); return 7; /* ld h, (hl) */
-  case 0x6e: reg(l) = read_byte_at(z80, hl(z80)); return 6; /* ld l, (hl) */
-
-  case 0x70: write_byte_at(z80, reg(b), hl(z80)); return 7; /* ld (hl), b */
-  case 0x71: write_byte_at(z80, reg(c), hl(z80)); return 7; /* ld (hl), c */
-  case 0x72: write_byte_at(z80, reg(d), hl(z80)); return 7; /* ld (hl), d */
-  case 0x73: write_byte_at(z80, reg(e), hl(z80)); return 7; /* ld (hl), e */
-  case 0x74: write_byte_at(z80, reg(h), hl(z80)); return 7; /* ld (hl), h */
-  case 0x75: write_byte_at(z80, reg(l), hl(z80)); return 7; /* ld (hl), l */
-  case 0x77: write_byte_at(z80, reg(a), hl(z80)); return 7; /* ld (hl), a */
-  case 0x36: write_byte_at(z80, read_byte(z80), hl(z80)); return 10; /* ld (hl), n */
-
-  case 0x0a: reg(a) = read_byte_at(z80, bc(z80)); return 7; /* ld a, (bc) */
-  case 0x1a: reg(a) = read_byte_at(z80, de(z80)); return 7; /* ld a, (de) */
-  case 0x3a: reg(a) = read_byte_at(z80, read_word(z80)); return 13; /* ld a, (nn) */
-
-  case 0x02: write_byte_at(z80, reg(a), bc(z80)); return 7; /* ld (bc), a */
-  case 0x12: write_byte_at(z80, reg(a), de(z80)); return 7; /* ld (de), a */
-  case 0x32: write_byte_at(z80, reg(a), read_word(z80)); return 13; /* ld (nn), a */
-
-  case 0x01: set_bc(z80, read_word(z80)); return 10; /* ld bc, nn */
-  case 0x11: set_de(z80, read_word(z80)); return 10; /* ld de, nn */
-  case 0x21: set_hl(z80, read_word(z80)); return 10; /* ld hl, nn */
-  case 0x31: z80->reg.sp = read_word(z80); return 10; /* ld sp, nn */
-
-  case 0x2a: set_hl(z80, read_word_at(z80, read_word(z80))); return 16; /* ld hl, (nn) */
-  case 0x22: write_word(z80, hl(z80)); return 16; /* ld (nn), hl */
-  case 0xf9: set_sp(z80, hl(z80)); return 6; /* ld sp, hl */
-  case 0xc5: push(z80, bc(z80)); return 11; /* push bc */
-  case 0xd5: push(z80, de(z80)); return 11; /* push de */
-  case 0xe5: push(z80, hl(z80)); return 11; /* push hl */
-  case 0xf5: push(z80, af(z80)); return 11; /* push af */
-  case 0xc1: set_bc(z80, pop(z80)); return 10; /* pop bc */
-  case 0xd1: set_de(z80, pop(z80)); return 10; /* pop de */
-  case 0xe1: set_hl(z80, pop(z80)); return 10; /* pop hl */
-  case 0xf1: set_af(z80, pop(z80)); return 10; /* pop af */
-
-  case 0x04: inc8(z80, &reg(b)); return 4; /* inc b */
-  case 0x0c: inc8(z80, &reg(c)); return 4; /* inc c */
-  case 0x14: inc8(z80, &reg(d)); return 4; /* inc d */
-  case 0x1c: inc8(z80, &reg(e)); return 4; /* inc e */
-  case 0x24: inc8(z80, &reg(h)); return 4; /* inc h */
-  case 0x2c: inc8(z80, &reg(l)); return 4; /* inc l */
-  case 0x3c: inc8(z80, &reg(a)); return 4; /* inc a */
-
-  case 0x05: dec8(z80, &reg(b)); return 4; /* dec b */
-  case 0x0d: dec8(z80, &reg(c)); return 4; /* dec c */
-  case 0x15: dec8(z80, &reg(d)); return 4; /* dec d */
-  case 0x1d: dec8(z80, &reg(e)); return 4; /* dec e */
-  case 0x25: dec8(z80, &reg(h)); return 4; /* dec h */
-  case 0x2d: dec8(z80, &reg(l)); return 4; /* dec l */
-  case 0x3d: dec8(z80, &reg(a)); return 4; /* dec a */
-
-  case 0x80: add8(z80, reg(b), 0); return 4; /* add a, b */
-  case 0x81: add8(z80, reg(c), 0); return 4; /* add a, c */
-  case 0x82: add8(z80, reg(d), 0); return 4; /* add a, d */
-  case 0x83: add8(z80, reg(e), 0); return 4; /* add a, e */
-  case 0x84: add8(z80, reg(h), 0); return 4; /* add a, h */
-  case 0x85: add8(z80, reg(l), 0); return 4; /* add a, l */
-  case 0x87: add8(z80, reg(a), 0); return 4; /* add a, a */
-  case 0xc6: add8(z80, read_byte(z80), 0); return 7; /* add a, n */
-  case 0x86: add8(z80, read_byte_at(z80, hl(z80)), 0); return 7; /* add a, (hl) */
-
-  case 0x88: add8(z80, reg(b), cf(z80)); return 4; /* adc a, b */
-  case 0x89: add8(z80, reg(c), cf(z80)); return 4; /* adc a, c */
-  case 0x8a: add8(z80, reg(d), cf(z80)); return 4; /* adc a, d */
-  case 0x8b: add8(z80, reg(e), cf(z80)); return 4; /* adc a, e */
-  case 0x8c: add8(z80, reg(h), cf(z80)); return 4; /* adc a, h */
-  case 0x8d: add8(z80, reg(l), cf(z80)); return 4; /* adc a, l */
-  case 0x8f: add8(z80, reg(a), cf(z80)); return 4; /* adc a, a */
-  case 0xce: add8(z80, read_byte(z80), cf(z80)); return 7; /* adc a, n */
-  case 0x8e: add8(z80, read_byte_at(z80, hl(z80)), cf(z80)); return 7; /* adc a, (hl) */
-
-  case 0x90: sub8(z80, reg(b), 0); return 4; /* sub b */
-  case 0x91: sub8(z80, reg(c), 0); return 4; /* sub c */
-  case 0x92: sub8(z80, reg(d), 0); return 4; /* sub d */
-  case 0x93: sub8(z80, reg(e), 0); return 4; /* sub e */
-  case 0x94: sub8(z80, reg(h), 0); return 4; /* sub h */
-  case 0x95: sub8(z80, reg(l), 0); return 4; /* sub l */
-  case 0x97: sub8(z80, reg(a), 0); return 4; /* sub a */
-  case 0xd6: sub8(z80, read_byte(z80), 0); return 7; /* sub n */
-  case 0x96: sub8(z80, read_byte_at(z80, hl(z80)), 0); return 7; /* sub (hl) */
-
-  case 0x98: sub8(z80, reg(b), cf(z80)); return 4; /* sbc a, b */
-  case 0x99: sub8(z80, reg(c), cf(z80)); return 4; /* sbc a, c */
-  case 0x9a: sub8(z80, reg(d), cf(z80)); return 4; /* sbc a, d */
-  case 0x9b: sub8(z80, reg(e), cf(z80)); return 4; /* sbc a, e */
-  case 0x9c: sub8(z80, reg(h), cf(z80)); return 4; /* sbc a, h */
-  case 0x9d: sub8(z80, reg(l), cf(z80)); return 4; /* sbc a, l */
-  case 0x9f: sub8(z80, reg(a), cf(z80)); return 4; /* sbc a, a */
-  case 0xde: sub8(z80, read_byte(z80), cf(z80)); return 7; /* sbc a, n */
-  case 0x9e: sub8(z80, read_byte_at(z80, hl(z80)), cf(z80)); return 7; /* sbc a, (hl) */
-
-  case 0xa0: and8(z80, reg(b)); return 4; /* and b */
-  case 0xa1: and8(z80, reg(c)); return 4; /* and c */
-  case 0xa2: and8(z80, reg(d)); return 4; /* and d */
-  case 0xa3: and8(z80, reg(e)); return 4; /* and e */
-  case 0xa4: and8(z80, reg(h)); return 4; /* and h */
-  case 0xa5: and8(z80, reg(l)); return 4; /* and l */
-  case 0xa7: and8(z80, reg(a)); return 4; /* and a */
-  case 0xe6: and8(z80, read_byte(z80)); return 7; /* and n */
-  case 0xa6: and8(z80, read_byte_at(z80, hl(z80))); return 7; /* and (hl) */
-
-  case 0xb0: or8(z80, reg(b)); return 4; /* or b */
-  case 0xb1: or8(z80, reg(c)); return 4; /* or c */
-  case 0xb2: or8(z80, reg(d)); return 4; /* or d */
-  case 0xb3: or8(z80, reg(e)); return 4; /* or e */
-  case 0xb4: or8(z80, reg(h)); return 4; /* or h */
-  case 0xb5: or8(z80, reg(l)); return 4; /* or l */
-  case 0xb7: or8(z80, reg(a)); return 4; /* or a */
-  case 0xf6: or8(z80, read_byte(z80)); return 7; /* or n */
-  case 0xb6: or8(z80, read_byte_at(z80, hl(z80))); return 7; /* or (hl) */
-
-  case 0xa8: xor8(z80, reg(b)); return 4; /* xor b */
-  case 0xa9: xor8(z80, reg(c)); return 4; /* xor c */
-  case 0xaa: xor8(z80, reg(d)); return 4; /* xor d */
-  case 0xab: xor8(z80, reg(e)); return 4; /* xor e */
-  case 0xac: xor8(z80, reg(h)); return 4; /* xor h */
-  case 0xad: xor8(z80, reg(l)); return 4; /* xor l */
-  case 0xaf: xor8(z80, reg(a)); return 4; /* xor a */
-  case 0xee: xor8(z80, read_byte(z80)); return 7; /* xor n */
-  case 0xae: xor8(z80, read_byte_at(z80, hl(z80))); return 7; /* xor (hl) */
-
-  case 0xb8: cp8(z80, reg(b)); return 4; /* cp b */
-  case 0xb9: cp8(z80, reg(c)); return 4; /* cp c */
-  case 0xba: cp8(z80, reg(d)); return 4; /* cp d */
-  case 0xbb: cp8(z80, reg(e)); return 4; /* cp e */
-  case 0xbc: cp8(z80, reg(h)); return 4; /* cp h */
-  case 0xbd: cp8(z80, reg(l)); return 4; /* cp l */
-  case 0xbf: cp8(z80, reg(a)); return 4; /* cp a */
-  case 0xfe: cp8(z80, read_byte(z80)); return 7; /* cp n */
-  case 0xbe: cp8(z80, read_byte_at(z80, hl(z80))); return 7; /* cp (hl) */
-
-  case 0x29: set_hl(z80, add16(z80, hl(z80), hl(z80))); return 11; /* add hl, hl */
-  case 0x39: set_hl(z80, add16(z80, hl(z80), z80->reg.sp)); return 11; /* add hl, sp */
-  case 0x19: set_hl(z80, add16(z80, hl(z80), de(z80))); return 11; /* add hl, de */
-  case 0x09: set_hl(z80, add16(z80, hl(z80), bc(z80))); return 11; /* add hl, bc */
-
-  case 0x03: set_bc(z80, inc16(z80, bc(z80))); return 6; /* inc bc */
-  case 0x13: set_de(z80, inc16(z80, de(z80))); return 6; /* inc de */
-  case 0x23: set_hl(z80, inc16(z80, hl(z80))); return 6; /* inc hl */
-  case 0x33: z80->reg.sp = inc16(z80, z80->reg.sp); return 6; /* inc sp */
-
-  case 0x0b: set_bc(z80, dec16(z80, bc(z80))); return 6; /* dec bc */
-  case 0x1b: set_de(z80, dec16(z80, de(z80))); return 6; /* dec de */
-  case 0x2b: set_hl(z80, dec16(z80, hl(z80))); return 6; /* dec hl */
-  case 0x3b: z80->reg.sp = inc16(z80, z80->reg.sp); return 6; /* dec sp */
-
-  case 0xc3: jp(z80, 1); return 10; /* jp nn */
-  case 0xc2: jp(z80, !zf(z80)); return 10; /* jp nz, nn */
-  case 0xca: jp(z80, zf(z80)); return 10; /* jp z, nn */
-  case 0xd2: jp(z80, !cf(z80)); return 10; /* jp nc, nn */
-  case 0xda: jp(z80, cf(z80)); return 10; /* jp c, nn */
-  case 0xe2: jp(z80, !pof(z80)); return 10; /* jp po, nn */
-  case 0xea: jp(z80, pof(z80)); return 10; /* jp pe, nn */
-  case 0xf2: jp(z80, !sf(z80)); return 10; /* jp p, nn */
-  case 0xfa: jp(z80, sf(z80)); return 10; /* jp m, nn */
-  case 0xe9: z80->reg.pc = hl(z80); return 4; /* jp (hl) */
-  case 0x18: return jr(z80, 1); /* jr d */
-  case 0x28: return jr(z80, zf(z80)); /* jr z, d */
-  case 0x20: return jr(z80, !zf(z80)); /* jr nz, d */
-  case 0x38: return jr(z80, cf(z80)); /* jr c, d */
-  case 0x30: return jr(z80, !cf(z80)); /* jr nc, d */
-  case 0x10: reg(b) = reg(b) - 1; return jr(z80, reg(b) != 0) + 1; /* djnz d */
-
-  case 0x27: daa(z80); return 4; /* daa */
-  case 0x2f: cpl(z80); return 4; /* cpl */
-
-  case 0x3f: ccf(z80); return 4; /* ccf */
-  case 0x37: scf(z80); return 4; /* scf */
-  case 0x00: return 4; /* nop */
-  case 0x76: z80->halt = 1; return 4; /* halt */
-  case 0xf3: set_iff1(z80, 0); set_iff2(z80, 0); return 4; /* di */
-  case 0xfb: set_iff1(z80, 1); set_iff2(z80, 1); return 4; /* ei */
-
-  case 0xcd: return call(z80, 1, read_word(z80)); /* call nn */
-  case 0xc4: return call(z80, !zf(z80), read_word(z80)); /* call nz, nn */
-  case 0xcc: return call(z80, zf(z80), read_word(z80)); /* call z, nn */
-  case 0xd4: return call(z80, !cf(z80), read_word(z80)); /* call nc, nn */
-  case 0xdc: return call(z80, cf(z80), read_word(z80)); /* call c, nn */
-  case 0xe4: return call(z80, !pof(z80), read_word(z80)); /* call po, nn */
-  case 0xec: return call(z80, pof(z80), read_word(z80)); /* call pe, nn */
-  case 0xf4: return call(z80, !sf(z80), read_word(z80)); /* call p, nn */
-  case 0xfc: return call(z80, sf(z80), read_word(z80)); /* call m, nn */
-
-  case 0xc9: return ret(z80, 1); /* ret */
-  case 0xc0: return ret(z80, !zf(z80)); /* ret nz */
-  case 0xc8: return ret(z80, zf(z80)); /* ret z */
-  case 0xd0: return ret(z80, !cf(z80)); /* ret nc */
-  case 0xd8: return ret(z80, cf(z80)); /* ret c */
-  case 0xe0: return ret(z80, !pof(z80)); /* ret po */
-  case 0xe8: return ret(z80, pof(z80)); /* ret pe */
-  case 0xf0: return ret(z80, !sf(z80)); /* ret p */
-  case 0xf8: return ret(z80, sf(z80)); /* ret m */
-
-  case 0xc7: return call(z80, 1, 0x0000); /* rst 0x00 */
-  case 0xcf: return call(z80, 1, 0x0008); /* rst 0x08 */
-  case 0xd7: return call(z80, 1, 0x0010); /* rst 0x10 */
-  case 0xdf: return call(z80, 1, 0x0018); /* rst 0x18 */
-  case 0xe7: return call(z80, 1, 0x0020); /* rst 0x20 */
-  case 0xef: return call(z80, 1, 0x0028); /* rst 0x28 */
-  case 0xf7: return call(z80, 1, 0x0030); /* rst 0x30 */
-  case 0xff: return call(z80, 1, 0x0038); /* rst 0x38 */
-
-  case 0xdb: reg(a) = io_read_byte(z80, read_byte(z80), reg(a)); return 11; /* in a, (n) */
-  case 0xd3: io_write_byte(z80, read_byte(z80), reg(a), reg(a)); return 11; /* out (n), a */
+  op_case(0x78) reg(a) = reg(b); return 4; /* ld a, b */
+  op_case(0x79) reg(a) = reg(c); return 4; /* ld a, c */
+  op_case(0x7a) reg(a) = reg(d); return 4; /* ld a, d */
+  op_case(0x7b) reg(a) = reg(e); return 4; /* ld a, e */
+  op_case(0x7c) reg(a) = reg(h); return 4; /* ld a, h */
+  op_case(0x7d) reg(a) = reg(l); return 4; /* ld a, l */
+  op_case(0x7f) reg(a) = reg(a); return 4; /* ld a, a */
+
+  op_case(0x40) reg(b) = reg(b); return 4; /* ld b, b */
+  op_case(0x41) reg(b) = reg(c); return 4; /* ld b, c */
+  op_case(0x42) reg(b) = reg(d); return 4; /* ld b, d */
+  op_case(0x43) reg(b) = reg(e); return 4; /* ld b, e */
+  op_case(0x44) reg(b) = reg(h); return 4; /* ld b, h */
+  op_case(0x45) reg(b) = reg(l); return 4; /* ld b, l */
+  op_case(0x47) reg(b) = reg(a); return 4; /* ld b, a */
+
+  op_case(0x48) reg(c) = reg(b); return 4; /* ld c, b */
+  op_case(0x49) reg(c) = reg(c); return 4; /* ld c, c */
+  op_case(0x4a) reg(c) = reg(d); return 4; /* ld c, d */
+  op_case(0x4b) reg(c) = reg(e); return 4; /* ld c, e */
+  op_case(0x4c) reg(c) = reg(h); return 4; /* ld c, h */
+  op_case(0x4d) reg(c) = reg(l); return 4; /* ld c, l */
+  op_case(0x4f) reg(c) = reg(a); return 4; /* ld c, a */
+
+  op_case(0x50) reg(d) = reg(b); return 4; /* ld d, b */
+  op_case(0x51) reg(d) = reg(c); return 4; /* ld d, c */
+  op_case(0x52) reg(d) = reg(d); return 4; /* ld d, d */
+  op_case(0x53) reg(d) = reg(e); return 4; /* ld d, e */
+  op_case(0x54) reg(d) = reg(h); return 4; /* ld d, h */
+  op_case(0x55) reg(d) = reg(l); return 4; /* ld d, l */
+  op_case(0x57) reg(d) = reg(a); return 4; /* ld d, a */
+
+  op_case(0x58) reg(e) = reg(b); return 4; /* ld e, b */
+  op_case(0x59) reg(e) = reg(c); return 4; /* ld e, c */
+  op_case(0x5a) reg(e) = reg(d); return 4; /* ld e, d */
+  op_case(0x5b) reg(e) = reg(e); return 4; /* ld e, e */
+  op_case(0x5c) reg(e) = reg(h); return 4; /* ld e, h */
+  op_case(0x5d) reg(e) = reg(l); return 4; /* ld e, l */
+  op_case(0x5f) reg(e) = reg(a); return 4; /* ld e, a */
+
+  op_case(0x60) reg(h) = reg(b); return 4; /* ld h, b */
+  op_case(0x61) reg(h) = reg(c); return 4; /* ld h, c */
+  op_case(0x62) reg(h) = reg(d); return 4; /* ld h, d */
+  op_case(0x63) reg(h) = reg(e); return 4; /* ld h, e */
+  op_case(0x64) reg(h) = reg(h); return 4; /* ld h, h */
+  op_case(0x65) reg(h) = reg(l); return 4; /* ld h, l */
+  op_case(0x67) reg(h) = reg(a); return 4; /* ld h, a */
+
+  op_case(0x68) reg(l) = reg(b); return 4; /* ld l, b */
+  op_case(0x69) reg(l) = reg(c); return 4; /* ld l, c */
+  op_case(0x6a) reg(l) = reg(d); return 4; /* ld l, d */
+  op_case(0x6b) reg(l) = reg(e); return 4; /* ld l, e */
+  op_case(0x6c) reg(l) = reg(h); return 4; /* ld l, h */
+  op_case(0x6d) reg(l) = reg(l); return 4; /* ld l, l */
+  op_case(0x6f) reg(l) = reg(a); return 4; /* ld l, a */
+
+  op_case(0x3e) reg(a) = read_byte(z80); return 7; /* ld a, n */
+  op_case(0x06) reg(b) = read_byte(z80); return 7; /* ld b, n */
+  op_case(0x0e) reg(c) = read_byte(z80); return 7; /* ld c, n */
+  op_case(0x16) reg(d) = read_byte(z80); return 7; /* ld d, n */
+  op_case(0x1e) reg(e) = read_byte(z80); return 7; /* ld e, n */
+  op_case(0x26) reg(h) = read_byte(z80); return 7; /* ld h, n */
+  op_case(0x2e) reg(l) = read_byte(z80); return 7; /* ld l, n */
+
+  op_case(0x7e) reg(a) = read_byte_at(z80, hl(z80)); return 7; /* ld a, (hl) */
+  op_case(0x46) reg(b) = read_byte_at(z80, hl(z80)); return 7; /* ld b, (hl) */
+  op_case(0x4e) reg(c) = read_byte_at(z80, hl(z80)); return 7; /* ld c, (hl) */
+  op_case(0x56) reg(d) = read_byte_at(z80, hl(z80)); return 7; /* ld d, (hl) */
+  op_case(0x5e) reg(e) = read_byte_at(z80, hl(z80)); return 6; /* ld e, (hl) */
+  op_case(0x66) reg(h) = read_byte_at(z80, hl(z80)); return 7; /* ld h, (hl) */
+  op_case(0x6e) reg(l) = read_byte_at(z80, hl(z80)); return 6; /* ld l, (hl) */
+
+  op_case(0x70) write_byte_at(z80, reg(b), hl(z80)); return 7; /* ld (hl), b */
+  op_case(0x71) write_byte_at(z80, reg(c), hl(z80)); return 7; /* ld (hl), c */
+  op_case(0x72) write_byte_at(z80, reg(d), hl(z80)); return 7; /* ld (hl), d */
+  op_case(0x73) write_byte_at(z80, reg(e), hl(z80)); return 7; /* ld (hl), e */
+  op_case(0x74) write_byte_at(z80, reg(h), hl(z80)); return 7; /* ld (hl), h */
+  op_case(0x75) write_byte_at(z80, reg(l), hl(z80)); return 7; /* ld (hl), l */
+  op_case(0x77) write_byte_at(z80, reg(a), hl(z80)); return 7; /* ld (hl), a */
+  op_case(0x36) write_byte_at(z80, read_byte(z80), hl(z80)); return 10; /* ld (hl), n */
+
+  op_case(0x0a) reg(a) = read_byte_at(z80, bc(z80)); return 7; /* ld a, (bc) */
+  op_case(0x1a) reg(a) = read_byte_at(z80, de(z80)); return 7; /* ld a, (de) */
+  op_case(0x3a) reg(a) = read_byte_at(z80, read_word(z80)); return 13; /* ld a, (nn) */
+
+  op_case(0x02) write_byte_at(z80, reg(a), bc(z80)); return 7; /* ld (bc), a */
+  op_case(0x12) write_byte_at(z80, reg(a), de(z80)); return 7; /* ld (de), a */
+  op_case(0x32) write_byte_at(z80, reg(a), read_word(z80)); return 13; /* ld (nn), a */
+
+  op_case(0x01) set_bc(z80, read_word(z80)); return 10; /* ld bc, nn */
+  op_case(0x11) set_de(z80, read_word(z80)); return 10; /* ld de, nn */
+  op_case(0x21) set_hl(z80, read_word(z80)); return 10; /* ld hl, nn */
+  op_case(0x31) z80->reg.sp = read_word(z80); return 10; /* ld sp, nn */
+
+  op_case(0x2a) set_hl(z80, read_word_at(z80, read_word(z80))); return 16; /* ld hl, (nn) */
+  op_case(0x22) write_word(z80, hl(z80)); return 16; /* ld (nn), hl */
+  op_case(0xf9) set_sp(z80, hl(z80)); return 6; /* ld sp, hl */
+  op_case(0xc5) push(z80, bc(z80)); return 11; /* push bc */
+  op_case(0xd5) push(z80, de(z80)); return 11; /* push de */
+  op_case(0xe5) push(z80, hl(z80)); return 11; /* push hl */
+  op_case(0xf5) push(z80, af(z80)); return 11; /* push af */
+  op_case(0xc1) set_bc(z80, pop(z80)); return 10; /* pop bc */
+  op_case(0xd1) set_de(z80, pop(z80)); return 10; /* pop de */
+  op_case(0xe1) set_hl(z80, pop(z80)); return 10; /* pop hl */
+  op_case(0xf1) set_af(z80, pop(z80)); return 10; /* pop af */
+
+  op_case(0x04) inc8(z80, &reg(b)); return 4; /* inc b */
+  op_case(0x0c) inc8(z80, &reg(c)); return 4; /* inc c */
+  op_case(0x14) inc8(z80, &reg(d)); return 4; /* inc d */
+  op_case(0x1c) inc8(z80, &reg(e)); return 4; /* inc e */
+  op_case(0x24) inc8(z80, &reg(h)); return 4; /* inc h */
+  op_case(0x2c) inc8(z80, &reg(l)); return 4; /* inc l */
+  op_case(0x3c) inc8(z80, &reg(a)); return 4; /* inc a */
+
+  op_case(0x05) dec8(z80, &reg(b)); return 4; /* dec b */
+  op_case(0x0d) dec8(z80, &reg(c)); return 4; /* dec c */
+  op_case(0x15) dec8(z80, &reg(d)); return 4; /* dec d */
+  op_case(0x1d) dec8(z80, &reg(e)); return 4; /* dec e */
+  op_case(0x25) dec8(z80, &reg(h)); return 4; /* dec h */
+  op_case(0x2d) dec8(z80, &reg(l)); return 4; /* dec l */
+  op_case(0x3d) dec8(z80, &reg(a)); return 4; /* dec a */
+
+  op_case(0x80) add8(z80, reg(b), 0); return 4; /* add a, b */
+  op_case(0x81) add8(z80, reg(c), 0); return 4; /* add a, c */
+  op_case(0x82) add8(z80, reg(d), 0); return 4; /* add a, d */
+  op_case(0x83) add8(z80, reg(e), 0); return 4; /* add a, e */
+  op_case(0x84) add8(z80, reg(h), 0); return 4; /* add a, h */
+  op_case(0x85) add8(z80, reg(l), 0); return 4; /* add a, l */
+  op_case(0x87) add8(z80, reg(a), 0); return 4; /* add a, a */
+  op_case(0xc6) add8(z80, read_byte(z80), 0); return 7; /* add a, n */
+  op_case(0x86) add8(z80, read_byte_at(z80, hl(z80)), 0); return 7; /* add a, (hl) */
+
+  op_case(0x88) add8(z80, reg(b), cf(z80)); return 4; /* adc a, b */
+  op_case(0x89) add8(z80, reg(c), cf(z80)); return 4; /* adc a, c */
+  op_case(0x8a) add8(z80, reg(d), cf(z80)); return 4; /* adc a, d */
+  op_case(0x8b) add8(z80, reg(e), cf(z80)); return 4; /* adc a, e */
+  op_case(0x8c) add8(z80, reg(h), cf(z80)); return 4; /* adc a, h */
+  op_case(0x8d) add8(z80, reg(l), cf(z80)); return 4; /* adc a, l */
+  op_case(0x8f) add8(z80, reg(a), cf(z80)); return 4; /* adc a, a */
+  op_case(0xce) add8(z80, read_byte(z80), cf(z80)); return 7; /* adc a, n */
+  op_case(0x8e) add8(z80, read_byte_at(z80, hl(z80)), cf(z80)); return 7; /* adc a, (hl) */
+
+  op_case(0x90) sub8(z80, reg(b), 0); return 4; /* sub b */
+  op_case(0x91) sub8(z80, reg(c), 0); return 4; /* sub c */
+  op_case(0x92) sub8(z80, reg(d), 0); return 4; /* sub d */
+  op_case(0x93) sub8(z80, reg(e), 0); return 4; /* sub e */
+  op_case(0x94) sub8(z80, reg(h), 0); return 4; /* sub h */
+  op_case(0x95) sub8(z80, reg(l), 0); return 4; /* sub l */
+  op_case(0x97) sub8(z80, reg(a), 0); return 4; /* sub a */
+  op_case(0xd6) sub8(z80, read_byte(z80), 0); return 7; /* sub n */
+  op_case(0x96) sub8(z80, read_byte_at(z80, hl(z80)), 0); return 7; /* sub (hl) */
+
+  op_case(0x98) sub8(z80, reg(b), cf(z80)); return 4; /* sbc a, b */
+  op_case(0x99) sub8(z80, reg(c), cf(z80)); return 4; /* sbc a, c */
+  op_case(0x9a) sub8(z80, reg(d), cf(z80)); return 4; /* sbc a, d */
+  op_case(0x9b) sub8(z80, reg(e), cf(z80)); return 4; /* sbc a, e */
+  op_case(0x9c) sub8(z80, reg(h), cf(z80)); return 4; /* sbc a, h */
+  op_case(0x9d) sub8(z80, reg(l), cf(z80)); return 4; /* sbc a, l */
+  op_case(0x9f) sub8(z80, reg(a), cf(z80)); return 4; /* sbc a, a */
+  op_case(0xde) sub8(z80, read_byte(z80), cf(z80)); return 7; /* sbc a, n */
+  op_case(0x9e) sub8(z80, read_byte_at(z80, hl(z80)), cf(z80)); return 7; /* sbc a, (hl) */
+
+  op_case(0xa0) and8(z80, reg(b)); return 4; /* and b */
+  op_case(0xa1) and8(z80, reg(c)); return 4; /* and c */
+  op_case(0xa2) and8(z80, reg(d)); return 4; /* and d */
+  op_case(0xa3) and8(z80, reg(e)); return 4; /* and e */
+  op_case(0xa4) and8(z80, reg(h)); return 4; /* and h */
+  op_case(0xa5) and8(z80, reg(l)); return 4; /* and l */
+  op_case(0xa7) and8(z80, reg(a)); return 4; /* and a */
+  op_case(0xe6) and8(z80, read_byte(z80)); return 7; /* and n */
+  op_case(0xa6) and8(z80, read_byte_at(z80, hl(z80))); return 7; /* and (hl) */
+
+  op_case(0xb0) or8(z80, reg(b)); return 4; /* or b */
+  op_case(0xb1) or8(z80, reg(c)); return 4; /* or c */
+  op_case(0xb2) or8(z80, reg(d)); return 4; /* or d */
+  op_case(0xb3) or8(z80, reg(e)); return 4; /* or e */
+  op_case(0xb4) or8(z80, reg(h)); return 4; /* or h */
+  op_case(0xb5) or8(z80, reg(l)); return 4; /* or l */
+  op_case(0xb7) or8(z80, reg(a)); return 4; /* or a */
+  op_case(0xf6) or8(z80, read_byte(z80)); return 7; /* or n */
+  op_case(0xb6) or8(z80, read_byte_at(z80, hl(z80))); return 7; /* or (hl) */
+
+  op_case(0xa8) xor8(z80, reg(b)); return 4; /* xor b */
+  op_case(0xa9) xor8(z80, reg(c)); return 4; /* xor c */
+  op_case(0xaa) xor8(z80, reg(d)); return 4; /* xor d */
+  op_case(0xab) xor8(z80, reg(e)); return 4; /* xor e */
+  op_case(0xac) xor8(z80, reg(h)); return 4; /* xor h */
+  op_case(0xad) xor8(z80, reg(l)); return 4; /* xor l */
+  op_case(0xaf) xor8(z80, reg(a)); return 4; /* xor a */
+  op_case(0xee) xor8(z80, read_byte(z80)); return 7; /* xor n */
+  op_case(0xae) xor8(z80, read_byte_at(z80, hl(z80))); return 7; /* xor (hl) */
+
+  op_case(0xb8) cp8(z80, reg(b)); return 4; /* cp b */
+  op_case(0xb9) cp8(z80, reg(c)); return 4; /* cp c */
+  op_case(0xba) cp8(z80, reg(d)); return 4; /* cp d */
+  op_case(0xbb) cp8(z80, reg(e)); return 4; /* cp e */
+  op_case(0xbc) cp8(z80, reg(h)); return 4; /* cp h */
+  op_case(0xbd) cp8(z80, reg(l)); return 4; /* cp l */
+  op_case(0xbf) cp8(z80, reg(a)); return 4; /* cp a */
+  op_case(0xfe) cp8(z80, read_byte(z80)); return 7; /* cp n */
+  op_case(0xbe) cp8(z80, read_byte_at(z80, hl(z80))); return 7; /* cp (hl) */
+
+  op_case(0x29) set_hl(z80, add16(z80, hl(z80), hl(z80))); return 11; /* add hl, hl */
+  op_case(0x39) set_hl(z80, add16(z80, hl(z80), z80->reg.sp)); return 11; /* add hl, sp */
+  op_case(0x19) set_hl(z80, add16(z80, hl(z80), de(z80))); return 11; /* add hl, de */
+  op_case(0x09) set_hl(z80, add16(z80, hl(z80), bc(z80))); return 11; /* add hl, bc */
+
+  op_case(0x03) set_bc(z80, inc16(z80, bc(z80))); return 6; /* inc bc */
+  op_case(0x13) set_de(z80, inc16(z80, de(z80))); return 6; /* inc de */
+  op_case(0x23) set_hl(z80, inc16(z80, hl(z80))); return 6; /* inc hl */
+  op_case(0x33) z80->reg.sp = inc16(z80, z80->reg.sp); return 6; /* inc sp */
+
+  op_case(0x0b) set_bc(z80, dec16(z80, bc(z80))); return 6; /* dec bc */
+  op_case(0x1b) set_de(z80, dec16(z80, de(z80))); return 6; /* dec de */
+  op_case(0x2b) set_hl(z80, dec16(z80, hl(z80))); return 6; /* dec hl */
+  op_case(0x3b) z80->reg.sp = inc16(z80, z80->reg.sp); return 6; /* dec sp */
+
+  op_case(0xc3) jp(z80, 1); return 10; /* jp nn */
+  op_case(0xc2) jp(z80, !zf(z80)); return 10; /* jp nz, nn */
+  op_case(0xca) jp(z80, zf(z80)); return 10; /* jp z, nn */
+  op_case(0xd2) jp(z80, !cf(z80)); return 10; /* jp nc, nn */
+  op_case(0xda) jp(z80, cf(z80)); return 10; /* jp c, nn */
+  op_case(0xe2) jp(z80, !pof(z80)); return 10; /* jp po, nn */
+  op_case(0xea) jp(z80, pof(z80)); return 10; /* jp pe, nn */
+  op_case(0xf2) jp(z80, !sf(z80)); return 10; /* jp p, nn */
+  op_case(0xfa) jp(z80, sf(z80)); return 10; /* jp m, nn */
+  op_case(0xe9) z80->reg.pc = hl(z80); return 4; /* jp (hl) */
+  op_case(0x18) return jr(z80, 1); /* jr d */
+  op_case(0x28) return jr(z80, zf(z80)); /* jr z, d */
+  op_case(0x20) return jr(z80, !zf(z80)); /* jr nz, d */
+  op_case(0x38) return jr(z80, cf(z80)); /* jr c, d */
+  op_case(0x30) return jr(z80, !cf(z80)); /* jr nc, d */
+  op_case(0x10) reg(b) = reg(b) - 1; return jr(z80, reg(b) != 0) + 1; /* djnz d */
+
+  op_case(0x27) daa(z80); return 4; /* daa */
+  op_case(0x2f) cpl(z80); return 4; /* cpl */
+
+  op_case(0x3f) ccf(z80); return 4; /* ccf */
+  op_case(0x37) scf(z80); return 4; /* scf */
+  op_case(0x00) return 4; /* nop */
+  op_case(0x76) z80->halt = 1; return 4; /* halt */
+  op_case(0xf3) set_iff1(z80, 0); set_iff2(z80, 0); return 4; /* di */
+  op_case(0xfb) set_iff1(z80, 1); set_iff2(z80, 1); z80->ei_shadow = 1; return 4; /* ei */
+
+  op_case(0xcd) return call(z80, 1, read_word(z80)); /* call nn */
+  op_case(0xc4) return call(z80, !zf(z80), read_word(z80)); /* call nz, nn */
+  op_case(0xcc) return call(z80, zf(z80), read_word(z80)); /* call z, nn */
+  op_case(0xd4) return call(z80, !cf(z80), read_word(z80)); /* call nc, nn */
+  op_case(0xdc) return call(z80, cf(z80), read_word(z80)); /* call c, nn */
+  op_case(0xe4) return call(z80, !pof(z80), read_word(z80)); /* call po, nn */
+  op_case(0xec) return call(z80, pof(z80), read_word(z80)); /* call pe, nn */
+  op_case(0xf4) return call(z80, !sf(z80), read_word(z80)); /* call p, nn */
+  op_case(0xfc) return call(z80, sf(z80), read_word(z80)); /* call m, nn */
+
+  op_case(0xc9) return ret(z80, 1); /* ret */
+  op_case(0xc0) return ret(z80, !zf(z80)); /* ret nz */
+  op_case(0xc8) return ret(z80, zf(z80)); /* ret z */
+  op_case(0xd0) return ret(z80, !cf(z80)); /* ret nc */
+  op_case(0xd8) return ret(z80, cf(z80)); /* ret c */
+  op_case(0xe0) return ret(z80, !pof(z80)); /* ret po */
+  op_case(0xe8) return ret(z80, pof(z80)); /* ret pe */
+  op_case(0xf0) return ret(z80, !sf(z80)); /* ret p */
+  op_case(0xf8) return ret(z80, sf(z80)); /* ret m */
+
+  op_case(0xc7) return call(z80, 1, 0x0000); /* rst 0x00 */
+  op_case(0xcf) return call(z80, 1, 0x0008); /* rst 0x08 */
+  op_case(0xd7) return call(z80, 1, 0x0010); /* rst 0x10 */
+  op_case(0xdf) return call(z80, 1, 0x0018); /* rst 0x18 */
+  op_case(0xe7) return call(z80, 1, 0x0020); /* rst 0x20 */
+  op_case(0xef) return call(z80, 1, 0x0028); /* rst 0x28 */
+  op_case(0xf7) return call(z80, 1, 0x0030); /* rst 0x30 */
+  op_case(0xff) return call(z80, 1, 0x0038); /* rst 0x38 */
+
+  op_case(0xdb) reg(a) = io_read_byte(z80, read_byte(z80), reg(a)); return 11; /* in a, (n) */
+  op_case(0xd3) io_write_byte(z80, read_byte(z80), reg(a), reg(a)); return 11; /* out (n), a */
 
     /* clang-format on */
 
-  case 0x07: /* rlca */
+  op_case(0x07) /* rlca */
     set_cf(z80, (reg(a) & 0x80) != 0);
     reg(a) = (reg(a) << 1) | cf(z80);
     set_nf(z80, 0);
@@ -539,7 +1164,7 @@ static zi8 z80e_execute(z80e* z80, zu8 opcode) {
     set_xf(z80, bit(reg(a), 3));
     return 4;
 
-  case 0x0f: /* rrca */
+  op_case(0x0f) /* rrca */
     set_cf(z80, (reg(a) & 0x01) != 0);
     set_nf(z80, 0);
     set_hf(z80, 0);
@@ -548,13 +1173,13 @@ static zi8 z80e_execute(z80e* z80, zu8 opcode) {
     set_xf(z80, bit(reg(a), 3));
     return 4;
 
-  case 0xeb: /* ex de, hl */
+  op_case(0xeb) /* ex de, hl */
     tmp16 = de(z80);
     set_de(z80, hl(z80));
     set_hl(z80, tmp16);
     return 4;
 
-  case 0x08: /* ex af, af' */
+  op_case(0x08) /* ex af, af' */
     tmp8 = z80->reg.main.a;
     z80->reg.alt.a = z80->reg.main.a;
     z80->reg.main.a = tmp8;
@@ -563,21 +1188,24 @@ static zi8 z80e_execute(z80e* z80, zu8 opcode) {
     z80->reg.main.f = tmp8;
     return 4;
 
-  case 0xd9: /* exx */
+  op_case(0xd9) /* exx */
+    /* `cur_reg_set` mirrors the pointer so z80e_save captures the selector */
     if (z80->reg.cur == &z80->reg.main) {
       z80->reg.cur = &z80->reg.alt;
+      z80->cur_reg_set = 1;
     } else if (z80->reg.cur == &z80->reg.alt) {
       z80->reg.cur = &z80->reg.main;
+      z80->cur_reg_set = 0;
     }
     return 4;
 
-  case 0xe3: /* ex (sp), hl */
+  op_case(0xe3) /* ex (sp), hl */
     tmp16 = read_word_at(z80, z80->reg.sp);
     write_word_at(z80, hl(z80), z80->reg.sp);
     set_hl(z80, tmp16);
     return 4;
 
-  case 0x17: /* rla */
+  op_case(0x17) /* rla */
     tmp8 = (reg(a) & 0x80) != 0;
     reg(a) = (reg(a) << 1) | (cf(z80) & 0x01);
     set_cf(z80, tmp8);
@@ -587,7 +1215,7 @@ static zi8 z80e_execute(z80e* z80, zu8 opcode) {
     set_xf(z80, bit(reg(a), 3));
     return 4;
 
-  case 0x1f: /* rra */
+  op_case(0x1f) /* rra */
     set_cf(z80, bit(reg(a), 0));
     reg(a) = (cf(z80) << 7) | (reg(a) >> 1);
     set_nf(z80, 0);
@@ -596,48 +1224,61 @@ static zi8 z80e_execute(z80e* z80, zu8 opcode) {
     set_xf(z80, bit(reg(a), 3));
     return 4;
 
-  case 0x34: /* inc (hl) */
+  op_case(0x34) /* inc (hl) */
     tmp8 = read_byte_at(z80, hl(z80));
     inc8(z80, &tmp8);
     write_byte_at(z80, tmp8, hl(z80));
     return 11;
 
-  case 0x35: /* dec (hl) */
+  op_case(0x35) /* dec (hl) */
     tmp8 = read_byte_at(z80, hl(z80));
     dec8(z80, &tmp8);
     write_byte_at(z80, tmp8, hl(z80));
     return 11;
 
-  case 0xcb:
-    return z80e_execute_cb(z80, read_byte(z80), 0, 0);
+  op_case(0xcb)
+    return z80e_execute_cb(z80, read_byte(z80), hl(z80), 0);
 
-  case 0xed:
+  op_case(0xed)
     return z80e_execute_ed(z80, read_byte(z80));
 
-  case 0xdd:
-    return z80e_execute_ddfd(z80, &z80->reg.ix, read_byte(z80));
-
-  case 0xfd:
-    return z80e_execute_ddfd(z80, &z80->reg.iy, read_byte(z80));
+  op_case(0xdd)
+  op_case(0xfd) {
+    /* Prefix chains are consumed in one loop instead of recursing per
+     * prefix: every redundant DD/FD acts as a 4 T-state no-op and the last
+     * one selects the index register, matching hardware */
+    zu16* rr = opcode == 0xdd ? &z80->reg.ix : &z80->reg.iy;
+    zi32 prefix_tstates = 0;
+    zu8 next = read_byte(z80);
+    while (next == 0xdd || next == 0xfd) {
+      rr = next == 0xdd ? &z80->reg.ix : &z80->reg.iy;
+      prefix_tstates += 4;
+      next = read_byte(z80);
+    }
+    zi32 ret = z80e_execute_ddfd(z80, rr, next);
+    return ret < 0 ? ret : ret + prefix_tstates;
+  }
 
-  default:
+  op_default
     return Z80E_INVALID_OPCODE;
   };
 }
 
-static zi8 z80e_execute_cb(z80e* z80, zu8 opcode, zu16 addr, int with_iz) {
+/* `addr` is the memory operand, resolved by the caller: hl for plain CB,
+ * iz+d (displacement fetched once) for DD/FD CB */
+static zi32 z80e_execute_cb(z80e* z80, zu8 opcode, zu16 addr, int with_iz) {
   zu8 tmp;
 
-  if (!with_iz) {
-    addr = hl(z80);
-  }
+  profile_count(opcode_cb, opcode);
 
 #define op_pointer(fn)                                                                                                 \
   tmp = read_byte_at(z80, addr);                                                                                       \
   fn;                                                                                                                  \
   write_byte_at(z80, tmp, addr);
 
+#ifdef Z80E_USE_COMPUTED_GOTO
 #define encode_bit_index(bit_pattern, code)                                                                            \
+  l_bit_##bit_pattern:                                                                                                 \
   case 0x00 | bit_pattern:                                                                                             \
   case 0x08 | bit_pattern:                                                                                             \
   case 0x10 | bit_pattern:                                                                                             \
@@ -648,79 +1289,118 @@ static zi8 z80e_execute_cb(z80e* z80, zu8 opcode, zu16 addr, int with_iz) {
   case 0x38 | bit_pattern:                                                                                             \
     code;
 
+#define bit_target(bit_pattern)                                                                                        \
+  [0x00 | bit_pattern] = &&l_bit_##bit_pattern, [0x08 | bit_pattern] = &&l_bit_##bit_pattern,                          \
+  [0x10 | bit_pattern] = &&l_bit_##bit_pattern, [0x18 | bit_pattern] = &&l_bit_##bit_pattern,                          \
+  [0x20 | bit_pattern] = &&l_bit_##bit_pattern, [0x28 | bit_pattern] = &&l_bit_##bit_pattern,                          \
+  [0x30 | bit_pattern] = &&l_bit_##bit_pattern, [0x38 | bit_pattern] = &&l_bit_##bit_pattern
+#else
+#define encode_bit_index(bit_pattern, code)                                                                            \
+  case 0x00 | bit_pattern:                                                                                             \
+  case 0x08 | bit_pattern:                                                                                             \
+  case 0x10 | bit_pattern:                                                                                             \
+  case 0x18 | bit_pattern:                                                                                             \
+  case 0x20 | bit_pattern:                                                                                             \
+  case 0x28 | bit_pattern:                                                                                             \
+  case 0x30 | bit_pattern:                                                                                             \
+  case 0x38 | bit_pattern:                                                                                             \
+    code;
+#endif
+
+#ifdef Z80E_USE_COMPUTED_GOTO
+  static void* const op_targets[256] = {
+      op_target(0x07), op_target(0x00), op_target(0x01), op_target(0x02), op_target(0x03), op_target(0x04), op_target(0x05),
+      op_target(0x06), op_target(0x17), op_target(0x10), op_target(0x11), op_target(0x12), op_target(0x13), op_target(0x14),
+      op_target(0x15), op_target(0x16), op_target(0x0f), op_target(0x08), op_target(0x09), op_target(0x0a), op_target(0x0b),
+      op_target(0x0c), op_target(0x0d), op_target(0x0e), op_target(0x1f), op_target(0x18), op_target(0x19), op_target(0x1a),
+      op_target(0x1b), op_target(0x1c), op_target(0x1d), op_target(0x1e), op_target(0x27), op_target(0x20), op_target(0x21),
+      op_target(0x22), op_target(0x23), op_target(0x24), op_target(0x25), op_target(0x26), op_target(0x2f), op_target(0x28),
+      op_target(0x29), op_target(0x2a), op_target(0x2b), op_target(0x2c), op_target(0x2d), op_target(0x2e), op_target(0x37),
+      op_target(0x30), op_target(0x31), op_target(0x32), op_target(0x33), op_target(0x34), op_target(0x35), op_target(0x36),
+      op_target(0x3f), op_target(0x38), op_target(0x39), op_target(0x3a), op_target(0x3b), op_target(0x3c), op_target(0x3d),
+      op_target(0x3e),
+      bit_target(0x47), bit_target(0x40), bit_target(0x41), bit_target(0x42), bit_target(0x43), bit_target(0x44),
+      bit_target(0x45), bit_target(0x46), bit_target(0xc7), bit_target(0xc0), bit_target(0xc1), bit_target(0xc2),
+      bit_target(0xc3), bit_target(0xc4), bit_target(0xc5), bit_target(0xc6), bit_target(0x87), bit_target(0x80),
+      bit_target(0x81), bit_target(0x82), bit_target(0x83), bit_target(0x84), bit_target(0x85), bit_target(0x86),
+  };
+#endif
+
+  op_dispatch(op_targets, opcode);
+
   switch (opcode) {
     /* clang-format off */
-  case 0x07: rlc(z80, &reg(a), addr, with_iz); return 8; /* rlc a */
-  case 0x00: rlc(z80, &reg(b), addr, with_iz); return 8; /* rlc b */
-  case 0x01: rlc(z80, &reg(c), addr, with_iz); return 8; /* rlc c */
-  case 0x02: rlc(z80, &reg(d), addr, with_iz); return 8; /* rlc d */
-  case 0x03: rlc(z80, &reg(e), addr, with_iz); return 8; /* rlc e */
-  case 0x04: rlc(z80, &reg(h), addr, with_iz); return 8; /* rlc h */
-  case 0x05: rlc(z80, &reg(l), addr, with_iz); return 8; /* rlc l */
-  case 0x06: op_pointer(rlc(z80, &tmp, addr, with_iz)); return 15; /* rlc (hl) */
-
-  case 0x17: rl(z80, &reg(a), addr, with_iz); return 8; /* rl a */
-  case 0x10: rl(z80, &reg(b), addr, with_iz); return 8; /* rl b */
-  case 0x11: rl(z80, &reg(c), addr, with_iz); return 8; /* rl c */
-  case 0x12: rl(z80, &reg(d), addr, with_iz); return 8; /* rl d */
-  case 0x13: rl(z80, &reg(e), addr, with_iz); return 8; /* rl e */
-  case 0x14: rl(z80, &reg(h), addr, with_iz); return 8; /* rl h */
-  case 0x15: rl(z80, &reg(l), addr, with_iz); return 8; /* rl l */
-  case 0x16: op_pointer(rl(z80, &tmp, addr, with_iz)); return 15; /* rl (hl) */
-
-  case 0x0f: rrc(z80, &reg(a), addr, with_iz); return 8; /* rrc a */
-  case 0x08: rrc(z80, &reg(b), addr, with_iz); return 8; /* rrc b */
-  case 0x09: rrc(z80, &reg(c), addr, with_iz); return 8; /* rrc c */
-  case 0x0a: rrc(z80, &reg(d), addr, with_iz); return 8; /* rrc d */
-  case 0x0b: rrc(z80, &reg(e), addr, with_iz); return 8; /* rrc e */
-  case 0x0c: rrc(z80, &reg(h), addr, with_iz); return 8; /* rrc h */
-  case 0x0d: rrc(z80, &reg(l), addr, with_iz); return 8; /* rrc l */
-  case 0x0e: op_pointer(rrc(z80, &tmp, addr, with_iz)); return 15; /* rrc (hl) */
-
-  case 0x1f: rr(z80, &reg(a), addr, with_iz); return 8; /* rr a */
-  case 0x18: rr(z80, &reg(b), addr, with_iz); return 8; /* rr b */
-  case 0x19: rr(z80, &reg(c), addr, with_iz); return 8; /* rr c */
-  case 0x1a: rr(z80, &reg(d), addr, with_iz); return 8; /* rr d */
-  case 0x1b: rr(z80, &reg(e), addr, with_iz); return 8; /* rr e */
-  case 0x1c: rr(z80, &reg(h), addr, with_iz); return 8; /* rr h */
-  case 0x1d: rr(z80, &reg(l), addr, with_iz); return 8; /* rr l */
-  case 0x1e: op_pointer(rr(z80, &tmp, addr, with_iz)); return 15; /* rr (hl) */
-
-  case 0x27: sla(z80, &reg(a), addr, with_iz); return 8; /* sla a / sla (iz+d), a */
-  case 0x20: sla(z80, &reg(b), addr, with_iz); return 8; /* sla b / sla (iz+d), b */
-  case 0x21: sla(z80, &reg(c), addr, with_iz); return 8; /* sla c / sla (iz+d), c */
-  case 0x22: sla(z80, &reg(d), addr, with_iz); return 8; /* sla d / sla (iz+d), d */
-  case 0x23: sla(z80, &reg(e), addr, with_iz); return 8; /* sla e / sla (iz+d), e */
-  case 0x24: sla(z80, &reg(h), addr, with_iz); return 8; /* sla h / sla (iz+d), h */
-  case 0x25: sla(z80, &reg(l), addr, with_iz); return 8; /* sla l / sla (iz+d), l */
-  case 0x26: op_pointer(sla(z80, &tmp, 0, 0)); return 15; /* sla (hl) / sla (iz+d) */
-
-  case 0x2f: sra(z80, &reg(a), addr, with_iz); return 8; /* sra a */
-  case 0x28: sra(z80, &reg(b), addr, with_iz); return 8; /* sra b */
-  case 0x29: sra(z80, &reg(c), addr, with_iz); return 8; /* sra c */
-  case 0x2a: sra(z80, &reg(d), addr, with_iz); return 8; /* sra d */
-  case 0x2b: sra(z80, &reg(e), addr, with_iz); return 8; /* sra e */
-  case 0x2c: sra(z80, &reg(h), addr, with_iz); return 8; /* sra h */
-  case 0x2d: sra(z80, &reg(l), addr, with_iz); return 8; /* sra l */
-  case 0x2e: op_pointer(sra(z80, &tmp, addr, with_iz)); return 15; /* sra (hl) */
-
-  case 0x37: sll(z80, &reg(a), addr, with_iz); return 8; /* sll a */
-  case 0x30: sll(z80, &reg(b), addr, with_iz); return 8; /* sll b */
-  case 0x31: sll(z80, &reg(c), addr, with_iz); return 8; /* sll c */
-  case 0x32: sll(z80, &reg(d), addr, with_iz); return 8; /* sll d */
-  case 0x33: sll(z80, &reg(e), addr, with_iz); return 8; /* sll e */
-  case 0x34: sll(z80, &reg(h), addr, with_iz); return 8; /* sll h */
-  case 0x35: sll(z80, &reg(l), addr, with_iz); return 8; /* sll l */
-  case 0x36: op_pointer(sll(z80, &tmp, addr, with_iz)); return 15; /* sll (hl) */
-
-  case 0x3f: srl(z80, &reg(a), addr, with_iz); return 8; /* srl a */
-  case 0x38: srl(z80, &reg(b), addr, with_iz); return 8; /* srl b */
-  case 0x39: srl(z80, &reg(c), addr, with_iz); return 8; /* srl c */
-  case 0x3a: srl(z80, &reg(d), addr, with_iz); return 8; /* srl d */
-  case 0x3b: srl(z80, &reg(e), addr, with_iz); return 8; /* srl e */
-  case 0x3c: srl(z80, &reg(h), addr, with_iz); return 8; /* srl h */
-  case 0x3d: srl(z80, &reg(l), addr, with_iz); return 8; /* srl l */
-  case 0x3e: op_pointer(srl(z80, &tmp, addr, with_iz)); return 15; /* srl (hl) */
+  op_case(0x07) rlc(z80, &reg(a), addr, with_iz); return 8; /* rlc a */
+  op_case(0x00) rlc(z80, &reg(b), addr, with_iz); return 8; /* rlc b */
+  op_case(0x01) rlc(z80, &reg(c), addr, with_iz); return 8; /* rlc c */
+  op_case(0x02) rlc(z80, &reg(d), addr, with_iz); return 8; /* rlc d */
+  op_case(0x03) rlc(z80, &reg(e), addr, with_iz); return 8; /* rlc e */
+  op_case(0x04) rlc(z80, &reg(h), addr, with_iz); return 8; /* rlc h */
+  op_case(0x05) rlc(z80, &reg(l), addr, with_iz); return 8; /* rlc l */
+  op_case(0x06) op_pointer(rlc(z80, &tmp, addr, with_iz)); return 15; /* rlc (hl) */
+
+  op_case(0x17) rl(z80, &reg(a), addr, with_iz); return 8; /* rl a */
+  op_case(0x10) rl(z80, &reg(b), addr, with_iz); return 8; /* rl b */
+  op_case(0x11) rl(z80, &reg(c), addr, with_iz); return 8; /* rl c */
+  op_case(0x12) rl(z80, &reg(d), addr, with_iz); return 8; /* rl d */
+  op_case(0x13) rl(z80, &reg(e), addr, with_iz); return 8; /* rl e */
+  op_case(0x14) rl(z80, &reg(h), addr, with_iz); return 8; /* rl h */
+  op_case(0x15) rl(z80, &reg(l), addr, with_iz); return 8; /* rl l */
+  op_case(0x16) op_pointer(rl(z80, &tmp, addr, with_iz)); return 15; /* rl (hl) */
+
+  op_case(0x0f) rrc(z80, &reg(a), addr, with_iz); return 8; /* rrc a */
+  op_case(0x08) rrc(z80, &reg(b), addr, with_iz); return 8; /* rrc b */
+  op_case(0x09) rrc(z80, &reg(c), addr, with_iz); return 8; /* rrc c */
+  op_case(0x0a) rrc(z80, &reg(d), addr, with_iz); return 8; /* rrc d */
+  op_case(0x0b) rrc(z80, &reg(e), addr, with_iz); return 8; /* rrc e */
+  op_case(0x0c) rrc(z80, &reg(h), addr, with_iz); return 8; /* rrc h */
+  op_case(0x0d) rrc(z80, &reg(l), addr, with_iz); return 8; /* rrc l */
+  op_case(0x0e) op_pointer(rrc(z80, &tmp, addr, with_iz)); return 15; /* rrc (hl) */
+
+  op_case(0x1f) rr(z80, &reg(a), addr, with_iz); return 8; /* rr a */
+  op_case(0x18) rr(z80, &reg(b), addr, with_iz); return 8; /* rr b */
+  op_case(0x19) rr(z80, &reg(c), addr, with_iz); return 8; /* rr c */
+  op_case(0x1a) rr(z80, &reg(d), addr, with_iz); return 8; /* rr d */
+  op_case(0x1b) rr(z80, &reg(e), addr, with_iz); return 8; /* rr e */
+  op_case(0x1c) rr(z80, &reg(h), addr, with_iz); return 8; /* rr h */
+  op_case(0x1d) rr(z80, &reg(l), addr, with_iz); return 8; /* rr l */
+  op_case(0x1e) op_pointer(rr(z80, &tmp, addr, with_iz)); return 15; /* rr (hl) */
+
+  op_case(0x27) sla(z80, &reg(a), addr, with_iz); return 8; /* sla a / sla (iz+d), a */
+  op_case(0x20) sla(z80, &reg(b), addr, with_iz); return 8; /* sla b / sla (iz+d), b */
+  op_case(0x21) sla(z80, &reg(c), addr, with_iz); return 8; /* sla c / sla (iz+d), c */
+  op_case(0x22) sla(z80, &reg(d), addr, with_iz); return 8; /* sla d / sla (iz+d), d */
+  op_case(0x23) sla(z80, &reg(e), addr, with_iz); return 8; /* sla e / sla (iz+d), e */
+  op_case(0x24) sla(z80, &reg(h), addr, with_iz); return 8; /* sla h / sla (iz+d), h */
+  op_case(0x25) sla(z80, &reg(l), addr, with_iz); return 8; /* sla l / sla (iz+d), l */
+  op_case(0x26) op_pointer(sla(z80, &tmp, 0, 0)); return 15; /* sla (hl) / sla (iz+d) */
+
+  op_case(0x2f) sra(z80, &reg(a), addr, with_iz); return 8; /* sra a */
+  op_case(0x28) sra(z80, &reg(b), addr, with_iz); return 8; /* sra b */
+  op_case(0x29) sra(z80, &reg(c), addr, with_iz); return 8; /* sra c */
+  op_case(0x2a) sra(z80, &reg(d), addr, with_iz); return 8; /* sra d */
+  op_case(0x2b) sra(z80, &reg(e), addr, with_iz); return 8; /* sra e */
+  op_case(0x2c) sra(z80, &reg(h), addr, with_iz); return 8; /* sra h */
+  op_case(0x2d) sra(z80, &reg(l), addr, with_iz); return 8; /* sra l */
+  op_case(0x2e) op_pointer(sra(z80, &tmp, addr, with_iz)); return 15; /* sra (hl) */
+
+  op_case(0x37) sll(z80, &reg(a), addr, with_iz); return 8; /* sll a */
+  op_case(0x30) sll(z80, &reg(b), addr, with_iz); return 8; /* sll b */
+  op_case(0x31) sll(z80, &reg(c), addr, with_iz); return 8; /* sll c */
+  op_case(0x32) sll(z80, &reg(d), addr, with_iz); return 8; /* sll d */
+  op_case(0x33) sll(z80, &reg(e), addr, with_iz); return 8; /* sll e */
+  op_case(0x34) sll(z80, &reg(h), addr, with_iz); return 8; /* sll h */
+  op_case(0x35) sll(z80, &reg(l), addr, with_iz); return 8; /* sll l */
+  op_case(0x36) op_pointer(sll(z80, &tmp, addr, with_iz)); return 15; /* sll (hl) */
+
+  op_case(0x3f) srl(z80, &reg(a), addr, with_iz); return 8; /* srl a */
+  op_case(0x38) srl(z80, &reg(b), addr, with_iz); return 8; /* srl b */
+  op_case(0x39) srl(z80, &reg(c), addr, with_iz); return 8; /* srl c */
+  op_case(0x3a) srl(z80, &reg(d), addr, with_iz); return 8; /* srl d */
+  op_case(0x3b) srl(z80, &reg(e), addr, with_iz); return 8; /* srl e */
+  op_case(0x3c) srl(z80, &reg(h), addr, with_iz); return 8; /* srl h */
+  op_case(0x3d) srl(z80, &reg(l), addr, with_iz); return 8; /* srl l */
+  op_case(0x3e) op_pointer(srl(z80, &tmp, addr, with_iz)); return 15; /* srl (hl) */
 
   encode_bit_index(0x47, { bit_op(z80, opcode, reg(a), addr, with_iz); return 2; }); /* bit n, a */
   encode_bit_index(0x40, { bit_op(z80, opcode, reg(b), addr, with_iz); return 2; }); /* bit n, b */
@@ -751,7 +1431,7 @@ static zi8 z80e_execute_cb(z80e* z80, zu8 opcode, zu16 addr, int with_iz) {
 
     /* clang-format on */
 
-  default:
+  op_default
     z80->reg.pc -= 2;
     return Z80E_INVALID_OPCODE;
   }
@@ -759,97 +1439,109 @@ static zi8 z80e_execute_cb(z80e* z80, zu8 opcode, zu16 addr, int with_iz) {
 #undef op_hl_pointer
 }
 
-static zi8 z80e_execute_ed(z80e* z80, zu8 opcode) {
+static zi32 z80e_execute_ed(z80e* z80, zu8 opcode) {
   zu8 tmp;
 
+  profile_count(opcode_ed, opcode);
+
 #define in_op_set_flags(dest_reg, fn_call)                                                                             \
   do {                                                                                                                 \
     dest_reg = fn_call;                                                                                                \
-    set_sf(z80, bit(dest_reg, 7));                                                                                     \
-    set_zf(z80, dest_reg == 0);                                                                                        \
-    set_yf(z80, bit(dest_reg, 5));                                                                                     \
-    set_hf(z80, 0);                                                                                                    \
-    set_xf(z80, bit(dest_reg, 3));                                                                                     \
-    set_pof(z80, is_even_parity(dest_reg));                                                                            \
-    set_nf(z80, 0);                                                                                                    \
+    reg(f) = (reg(f) & 0x01) | szyx_table[dest_reg] | parity_table[dest_reg];                                          \
   } while (0)
 
+#ifdef Z80E_USE_COMPUTED_GOTO
+  static void* const op_targets[256] = {
+      op_target(0x47), op_target(0x4f), op_target(0x4b), op_target(0x5b), op_target(0x6b), op_target(0x7b), op_target(0x43),
+      op_target(0x53), op_target(0x63), op_target(0x73), op_target(0xa0), op_target(0xb0), op_target(0xa8), op_target(0xb8),
+      op_target(0xa1), op_target(0xb1), op_target(0xa9), op_target(0xb9), op_target(0x44), op_target(0x46), op_target(0x56),
+      op_target(0x5e), op_target(0x4a), op_target(0x5a), op_target(0x6a), op_target(0x7a), op_target(0x42), op_target(0x52),
+      op_target(0x62), op_target(0x72), op_target(0x6f), op_target(0x67), op_target(0x4d), op_target(0x78), op_target(0x40),
+      op_target(0x48), op_target(0x50), op_target(0x58), op_target(0x60), op_target(0x68), op_target(0x70), op_target(0x71),
+      op_target(0xa2), op_target(0xaa), op_target(0xb2), op_target(0xba), op_target(0x79), op_target(0x41), op_target(0x49),
+      op_target(0x51), op_target(0x59), op_target(0x61), op_target(0x69), op_target(0xa3), op_target(0xb3), op_target(0xab),
+      op_target(0xbb), op_target(0x57), op_target(0x5f), op_target(0x45),
+  };
+#endif
+
+  op_dispatch(op_targets, opcode);
+
   switch (opcode) {
     /* clang-format off */
-  case 0x47: z80->reg.i = reg(a); return 9; /* ld i, a */
-  case 0x4f: z80->reg.r = reg(a); return 9; /* ld r, a */
-
-  case 0x4b: set_bc(z80, read_word_at(z80, read_word(z80))); return 20; /* ld bc, (nn) */
-  case 0x5b: set_de(z80, read_word_at(z80, read_word(z80))); return 20; /* ld de, (nn) */
-  case 0x6b: set_hl(z80, read_word_at(z80, read_word(z80))); return 20; /* ld hl, (nn) */
-  case 0x7b: set_sp(z80, read_word_at(z80, read_word(z80))); return 20; /* ld sp, (nn) */
-
-  case 0x43: write_word_at(z80, bc(z80), read_word(z80)); return 20; /* ld (nn), bc */
-  case 0x53: write_word_at(z80, de(z80), read_word(z80)); return 20; /* ld (nn), de */
-  case 0x63: write_word_at(z80, hl(z80), read_word(z80)); return 20; /* ld (nn), hl */
-  case 0x73: write_word_at(z80, sp(z80), read_word(z80)); return 20; /* ld (nn), sp */
-
-  case 0xa0: return ldi(z80); /* ldi */
-  case 0xb0: return ldir(z80); /* ldir */
-  case 0xa8: return ldd(z80); /* ldd */
-  case 0xb8: return lddr(z80); /* lddr */
-  case 0xa1: return cpi(z80); /* cpi */
-  case 0xb1: return cpir(z80); /* cpir */
-  case 0xa9: return cpd(z80); /* cpd */
-  case 0xb9: return cpdr(z80); /* cpdr */
-
-  case 0x44: neg(z80); return 8; return 8; /* neg */
-  case 0x46: z80->int_mode = 0; return 8; /* im 0 */
-  case 0x56: z80->int_mode = 1; return 8; /* im 1 */
-  case 0x5e: z80->int_mode = 2; return 8; /* im 2 */
-
-  case 0x4a: set_hl(z80, adc16(z80, hl(z80), bc(z80), cf(z80))); return 15; /* adc hl, bc */
-  case 0x5a: set_hl(z80, adc16(z80, hl(z80), de(z80), cf(z80))); return 15; /* adc hl, de */
-  case 0x6a: set_hl(z80, adc16(z80, hl(z80), hl(z80), cf(z80))); return 15; /* adc hl, hl */
-  case 0x7a: set_hl(z80, adc16(z80, hl(z80), sp(z80), cf(z80))); return 15; /* adc hl, sp */
-
-  case 0x42: set_hl(z80, sbc16(z80, hl(z80), bc(z80), cf(z80)));; return 15; /* sbc hl, bc */
-  case 0x52: set_hl(z80, sbc16(z80, hl(z80), de(z80), cf(z80)));; return 15; /* sbc hl, de */
-  case 0x62: set_hl(z80, sbc16(z80, hl(z80), de(z80), cf(z80)));; return 15; /* sbc hl, hl */
-  case 0x72: set_hl(z80, sbc16(z80, hl(z80), sp(z80), cf(z80)));; return 15; /* sbc hl, sp */
-
-  case 0x6f: rld(z80); return 18; /* rld */
-  case 0x67: rrd(z80); return 18; /* rrd */
-
-  case 0x4d: ret(z80, 1); return 14; /* reti */
-
-  case 0x78: in_op_set_flags(reg(a), io_read_byte(z80, reg(c), reg(b))); return 12; /* in a, (c) */
-  case 0x40: in_op_set_flags(reg(b), io_read_byte(z80, reg(c), reg(b))); return 12; /* in b, (c) */
-  case 0x48: in_op_set_flags(reg(c), io_read_byte(z80, reg(c), reg(b))); return 12; /* in c, (c) */
-  case 0x50: in_op_set_flags(reg(d), io_read_byte(z80, reg(c), reg(b))); return 12; /* in d, (c) */
-  case 0x58: in_op_set_flags(reg(e), io_read_byte(z80, reg(c), reg(b))); return 12; /* in e, (c) */
-  case 0x60: in_op_set_flags(reg(h), io_read_byte(z80, reg(c), reg(b))); return 12; /* in h, (c) */
-  case 0x68: in_op_set_flags(reg(l), io_read_byte(z80, reg(c), reg(b))); return 12; /* in l, (c) */
-
-  case 0x70: in_op_set_flags(tmp, io_read_byte(z80, reg(c), reg(b))); return 12; /* in (c) - undoc */
-  case 0x71: io_write_byte(z80, reg(c), reg(b), 0); return 12; /* out (c), 0 - undoc */
-
-  case 0xa2: in_id(z80, 0); return 16; /* ini */
-  case 0xaa: in_id(z80, 1); return 16; /* ind */
-  case 0xb2: return inr(z80, 0); /* inir */
-  case 0xba: return inr(z80, 1); /* indr */
-
-  case 0x79: io_write_byte(z80, reg(c), reg(b), reg(a)); return 12; /* out (c), a */
-  case 0x41: io_write_byte(z80, reg(c), reg(b), reg(b)); return 12; /* out (c), b */
-  case 0x49: io_write_byte(z80, reg(c), reg(b), reg(c)); return 12; /* out (c), c */
-  case 0x51: io_write_byte(z80, reg(c), reg(b), reg(d)); return 12; /* out (c), d */
-  case 0x59: io_write_byte(z80, reg(c), reg(b), reg(e)); return 12; /* out (c), e */
-  case 0x61: io_write_byte(z80, reg(c), reg(b), reg(h)); return 12; /* out (c), h */
-  case 0x69: io_write_byte(z80, reg(c), reg(b), reg(l)); return 12; /* out (c), l */
-
-  case 0xa3: out_id(z80, 0); return 16; /* outi */
-  case 0xb3: return outr(z80, 0); /* otir */
-  case 0xab: out_id(z80, 1); return 16; /* outd */
-  case 0xbb: return outr(z80, 1); /* otdr */
+  op_case(0x47) z80->reg.i = reg(a); return 9; /* ld i, a */
+  op_case(0x4f) z80->reg.r = reg(a); return 9; /* ld r, a */
+
+  op_case(0x4b) set_bc(z80, read_word_at(z80, read_word(z80))); return 20; /* ld bc, (nn) */
+  op_case(0x5b) set_de(z80, read_word_at(z80, read_word(z80))); return 20; /* ld de, (nn) */
+  op_case(0x6b) set_hl(z80, read_word_at(z80, read_word(z80))); return 20; /* ld hl, (nn) */
+  op_case(0x7b) set_sp(z80, read_word_at(z80, read_word(z80))); return 20; /* ld sp, (nn) */
+
+  op_case(0x43) write_word_at(z80, bc(z80), read_word(z80)); return 20; /* ld (nn), bc */
+  op_case(0x53) write_word_at(z80, de(z80), read_word(z80)); return 20; /* ld (nn), de */
+  op_case(0x63) write_word_at(z80, hl(z80), read_word(z80)); return 20; /* ld (nn), hl */
+  op_case(0x73) write_word_at(z80, sp(z80), read_word(z80)); return 20; /* ld (nn), sp */
+
+  op_case(0xa0) return ldi(z80); /* ldi */
+  op_case(0xb0) return ldir(z80); /* ldir */
+  op_case(0xa8) return ldd(z80); /* ldd */
+  op_case(0xb8) return lddr(z80); /* lddr */
+  op_case(0xa1) return cpi(z80); /* cpi */
+  op_case(0xb1) return cpir(z80); /* cpir */
+  op_case(0xa9) return cpd(z80); /* cpd */
+  op_case(0xb9) return cpdr(z80); /* cpdr */
+
+  op_case(0x44) neg(z80); return 8; return 8; /* neg */
+  op_case(0x46) z80->int_mode = 0; return 8; /* im 0 */
+  op_case(0x56) z80->int_mode = 1; return 8; /* im 1 */
+  op_case(0x5e) z80->int_mode = 2; return 8; /* im 2 */
+
+  op_case(0x4a) set_hl(z80, adc16(z80, hl(z80), bc(z80), cf(z80))); return 15; /* adc hl, bc */
+  op_case(0x5a) set_hl(z80, adc16(z80, hl(z80), de(z80), cf(z80))); return 15; /* adc hl, de */
+  op_case(0x6a) set_hl(z80, adc16(z80, hl(z80), hl(z80), cf(z80))); return 15; /* adc hl, hl */
+  op_case(0x7a) set_hl(z80, adc16(z80, hl(z80), sp(z80), cf(z80))); return 15; /* adc hl, sp */
+
+  op_case(0x42) set_hl(z80, sbc16(z80, hl(z80), bc(z80), cf(z80)));; return 15; /* sbc hl, bc */
+  op_case(0x52) set_hl(z80, sbc16(z80, hl(z80), de(z80), cf(z80)));; return 15; /* sbc hl, de */
+  op_case(0x62) set_hl(z80, sbc16(z80, hl(z80), de(z80), cf(z80)));; return 15; /* sbc hl, hl */
+  op_case(0x72) set_hl(z80, sbc16(z80, hl(z80), sp(z80), cf(z80)));; return 15; /* sbc hl, sp */
+
+  op_case(0x6f) rld(z80); return 18; /* rld */
+  op_case(0x67) rrd(z80); return 18; /* rrd */
+
+  op_case(0x4d) ret(z80, 1); return 14; /* reti */
+
+  op_case(0x78) in_op_set_flags(reg(a), io_read_byte(z80, reg(c), reg(b))); return 12; /* in a, (c) */
+  op_case(0x40) in_op_set_flags(reg(b), io_read_byte(z80, reg(c), reg(b))); return 12; /* in b, (c) */
+  op_case(0x48) in_op_set_flags(reg(c), io_read_byte(z80, reg(c), reg(b))); return 12; /* in c, (c) */
+  op_case(0x50) in_op_set_flags(reg(d), io_read_byte(z80, reg(c), reg(b))); return 12; /* in d, (c) */
+  op_case(0x58) in_op_set_flags(reg(e), io_read_byte(z80, reg(c), reg(b))); return 12; /* in e, (c) */
+  op_case(0x60) in_op_set_flags(reg(h), io_read_byte(z80, reg(c), reg(b))); return 12; /* in h, (c) */
+  op_case(0x68) in_op_set_flags(reg(l), io_read_byte(z80, reg(c), reg(b))); return 12; /* in l, (c) */
+
+  op_case(0x70) in_op_set_flags(tmp, io_read_byte(z80, reg(c), reg(b))); return 12; /* in (c) - undoc */
+  op_case(0x71) io_write_byte(z80, reg(c), reg(b), 0); return 12; /* out (c), 0 - undoc */
+
+  op_case(0xa2) in_id(z80, 0); return 16; /* ini */
+  op_case(0xaa) in_id(z80, 1); return 16; /* ind */
+  op_case(0xb2) return inr(z80, 0); /* inir */
+  op_case(0xba) return inr(z80, 1); /* indr */
+
+  op_case(0x79) io_write_byte(z80, reg(c), reg(b), reg(a)); return 12; /* out (c), a */
+  op_case(0x41) io_write_byte(z80, reg(c), reg(b), reg(b)); return 12; /* out (c), b */
+  op_case(0x49) io_write_byte(z80, reg(c), reg(b), reg(c)); return 12; /* out (c), c */
+  op_case(0x51) io_write_byte(z80, reg(c), reg(b), reg(d)); return 12; /* out (c), d */
+  op_case(0x59) io_write_byte(z80, reg(c), reg(b), reg(e)); return 12; /* out (c), e */
+  op_case(0x61) io_write_byte(z80, reg(c), reg(b), reg(h)); return 12; /* out (c), h */
+  op_case(0x69) io_write_byte(z80, reg(c), reg(b), reg(l)); return 12; /* out (c), l */
+
+  op_case(0xa3) out_id(z80, 0); return 16; /* outi */
+  op_case(0xb3) return outr(z80, 0); /* otir */
+  op_case(0xab) out_id(z80, 1); return 16; /* outd */
+  op_case(0xbb) return outr(z80, 1); /* otdr */
 
     /* clang-format on */
 
-  case 0x57: /* ld a, i */
+  op_case(0x57) /* ld a, i */
     reg(a) = z80->reg.i;
     set_sf(z80, u8_negative(z80->reg.i));
     set_zf(z80, z80->reg.i == 0);
@@ -858,7 +1550,7 @@ static zi8 z80e_execute_ed(z80e* z80, zu8 opcode) {
     set_nf(z80, 0);
     return 9;
 
-  case 0x5f: /* ld a, r */
+  op_case(0x5f) /* ld a, r */
     reg(a) = z80->reg.r;
     set_sf(z80, u8_negative(z80->reg.r));
     set_zf(z80, z80->reg.r == 0);
@@ -867,12 +1559,12 @@ static zi8 z80e_execute_ed(z80e* z80, zu8 opcode) {
     set_nf(z80, 0);
     return 9;
 
-  case 0x45: /* retn */
+  op_case(0x45) /* retn */
     ret(z80, 1);
     set_iff1(z80, iff2(z80));
     return 14;
 
-  default:
+  op_default
     z80->reg.pc -= 2;
     return Z80E_INVALID_OPCODE;
   }
@@ -880,235 +1572,208 @@ static zi8 z80e_execute_ed(z80e* z80, zu8 opcode) {
 #undef in_op_set_flags
 }
 
-static zi8 z80e_execute_ddfd(z80e* z80, zu16* rr, zu8 opcode) {
+static zi32 z80e_execute_ddfd(z80e* z80, zu16* rr, zu8 opcode) {
   zu16 tmp;
 
+  profile_count(opcode_ddfd, opcode);
+
+#ifdef Z80E_USE_COMPUTED_GOTO
+  static void* const op_targets[256] = {
+      op_target(0x7e), op_target(0x46), op_target(0x4e), op_target(0x56), op_target(0x5e), op_target(0x66), op_target(0x6e),
+      op_target(0x70), op_target(0x71), op_target(0x72), op_target(0x73), op_target(0x74), op_target(0x75), op_target(0x77),
+      op_target(0x22), op_target(0xf9), op_target(0x21), op_target(0x2a), op_target(0xe5), op_target(0xe1), op_target(0x86),
+      op_target(0x8e), op_target(0x96), op_target(0x9e), op_target(0xa6), op_target(0xb6), op_target(0xae), op_target(0xbe),
+      op_target(0x32), op_target(0x35), op_target(0x09), op_target(0x19), op_target(0x29), op_target(0x39), op_target(0x23),
+      op_target(0x2b), op_target(0xe9), op_target(0x24), op_target(0x25), op_target(0x26), op_target(0x2c), op_target(0x2d),
+      op_target(0x2e), op_target(0x67), op_target(0x60), op_target(0x61), op_target(0x62), op_target(0x63), op_target(0x6f),
+      op_target(0x68), op_target(0x69), op_target(0x6a), op_target(0x6b), op_target(0x7c), op_target(0x44), op_target(0x4c),
+      op_target(0x54), op_target(0x5c), op_target(0x7d), op_target(0x45), op_target(0x4d), op_target(0x55), op_target(0x5d),
+      op_target(0x64), op_target(0x65), op_target(0x6c), op_target(0x6d), op_target(0x84), op_target(0x85), op_target(0x8c),
+      op_target(0x8d), op_target(0x94), op_target(0x95), op_target(0x9c), op_target(0x9d), op_target(0xa4), op_target(0xa5),
+      op_target(0xac), op_target(0xad), op_target(0xb4), op_target(0xb5), op_target(0xbc), op_target(0xbd), op_target(0x36),
+      op_target(0xe3), op_target(0xcb),
+  };
+#endif
+
+  op_dispatch(op_targets, opcode);
+
   switch (opcode) {
     /* clang-format off */
-  case 0x7e: reg(a) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld a, (iz+d) */
-  case 0x46: reg(b) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld b, (iz+d) */
-  case 0x4e: reg(c) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld c, (iz+d) */
-  case 0x56: reg(d) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld d, (iz+d) */
-  case 0x5e: reg(e) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld e, (iz+d) */
-  case 0x66: reg(h) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld h, (iz+d) */
-  case 0x6e: reg(l) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld l, (iz+d) */
-
-  case 0x70: write_byte_at(z80, reg(b), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), b */
-  case 0x71: write_byte_at(z80, reg(c), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), c */
-  case 0x72: write_byte_at(z80, reg(d), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), d */
-  case 0x73: write_byte_at(z80, reg(e), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), e */
-  case 0x74: write_byte_at(z80, reg(h), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), h */
-  case 0x75: write_byte_at(z80, reg(l), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), l */
-  case 0x77: write_byte_at(z80, reg(a), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), a */
-
-  case 0x22: write_word_at(z80, *rr, read_word(z80)); return 20; /* ld (nn), iz */
-  case 0xf9: z80->reg.sp = *rr; return 10; /* ld sp, iz */
-
-  case 0x21: *rr = read_word(z80); return 14; /* ld iz, nn */
-  case 0x2a: *rr = read_word_at(z80, read_word(z80)); return 20; /* ld iz, nn */
-
-  case 0xe5: push(z80, *rr); return 15; /* push iz */
-  case 0xe1: *rr = pop(z80); return 14; /* pop iz */
-
-  case 0x86: add8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80)), 0); return 19; /* add a, (iz+d) */
-  case 0x8e: add8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80)), cf(z80)); return 19; /* adc a, (iz+d) */
-  case 0x96: sub8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80)), 0); return 19; /* sub a, (iz+d) */
-  case 0x9e: sub8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80)), cf(z80)); return 19; /* sbc a, (iz+d) */
-  case 0xa6: and8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80))); return 19; /* and (iz+d) */
-  case 0xb6: or8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80))); return 19; /* or (iz+d) */
-  case 0xae: xor8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80))); return 19; /* xor (iz+d) */
-  case 0xbe: cp8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80))); return 19; /* cp (iz+d) */
-  case 0x32: inc_addr(z80, *rr + (zi8)read_byte(z80)); return 23; /* inc (iz+d) */
-  case 0x35: dec_addr(z80, *rr + (zi8)read_byte(z80)); return 23; /* dec (iz+d) */
-
-  case 0x09: *rr = add16(z80, *rr, bc(z80)); return 15; /* add iz, bc */
-  case 0x19: *rr = add16(z80, *rr, de(z80)); return 15; /* add iz, de */
-  case 0x29: *rr = add16(z80, *rr, *rr); return 15; /* add iz, iz */
-  case 0x39: *rr = add16(z80, *rr, sp(z80)); return 15; /* add iz, sp */
-
-  case 0x23: *rr = inc16(z80, *rr); return 10; /* inc iz */
-  case 0x2b: *rr = dec16(z80, *rr); return 10; /* dec iz */
-
-  case 0xe9: z80->reg.pc = *rr; return 8; /* jp (iz) */
-
-  case 0x24: inc8(z80, hptr(rr)); return 8; /* inc izh */
-  case 0x25: dec8(z80, hptr(rr)); return 8; /* dec izh */
-  case 0x26: *hptr(rr) = read_byte(z80); return 11; /* ld izh, n */
-
-  case 0x2c: inc8(z80, lptr(rr)); return 8; /* inc izl */
-  case 0x2d: dec8(z80, lptr(rr)); return 8; /* dec izl */
-  case 0x2e: *lptr(rr) = read_byte(z80); return 11; /* ld izl, n */
-
-  case 0x67: *hptr(rr) = reg(a); return 8; /* ld izh, a */
-  case 0x60: *hptr(rr) = reg(b); return 8; /* ld izh, b */
-  case 0x61: *hptr(rr) = reg(c); return 8; /* ld izh, c */
-  case 0x62: *hptr(rr) = reg(d); return 8; /* ld izh, d */
-  case 0x63: *hptr(rr) = reg(e); return 8; /* ld izh, e */
-
-  case 0x6f: *lptr(rr) = reg(a); return 8; /* ld izl, a */
-  case 0x68: *lptr(rr) = reg(b); return 8; /* ld izl, b */
-  case 0x69: *lptr(rr) = reg(c); return 8; /* ld izl, c */
-  case 0x6a: *lptr(rr) = reg(d); return 8; /* ld izl, d */
-  case 0x6b: *lptr(rr) = reg(e); return 8; /* ld izl, e */
-
-  case 0x7c: reg(a) = *hptr(rr); return 8; /* ld a, izh */
-  case 0x44: reg(b) = *hptr(rr); return 8; /* ld b, izh */
-  case 0x4c: reg(c) = *hptr(rr); return 8; /* ld c, izh */
-  case 0x54: reg(d) = *hptr(rr); return 8; /* ld d, izh */
-  case 0x5c: reg(e) = *hptr(rr); return 8; /* ld e, izh */
-
-  case 0x7d: reg(a) = *lptr(rr); return 8; /* ld a, izl */
-  case 0x45: reg(b) = *lptr(rr); return 8; /* ld b, izl */
-  case 0x4d: reg(c) = *lptr(rr); return 8; /* ld c, izl */
-  case 0x55: reg(d) = *lptr(rr); return 8; /* ld d, izl */
-  case 0x5d: reg(e) = *lptr(rr); return 8; /* ld e, izl */
-
-  case 0x64: *hptr(rr) = *hptr(rr); return 8; /* ld izh, izh */
-  case 0x65: *hptr(rr) = *lptr(rr); return 8; /* ld izh, izl */
-  case 0x6c: *lptr(rr) = *hptr(rr); return 8; /* ld izl, izh */
-  case 0x6d: *lptr(rr) = *hptr(rr); return 8; /* ld izl, izl */
-
-  case 0x84: add8(z80, *hptr(rr), 0); return 8; /* add a, izh */
-  case 0x85: add8(z80, *lptr(rr), 0); return 8; /* add a, izl */
-
-  case 0x8c: add8(z80, *hptr(rr), cf(z80)); return 8; /* adc a, izh */
-  case 0x8d: add8(z80, *lptr(rr), cf(z80)); return 8; /* adc a, izl */
-
-  case 0x94: sub8(z80, *hptr(rr), 0); return 8; /* sub izh */
-  case 0x95: sub8(z80, *lptr(rr), 0); return 8; /* sub izl */
-
-  case 0x9c: sub8(z80, *hptr(rr), cf(z80)); return 8; /* sbc izh */
-  case 0x9d: sub8(z80, *lptr(rr), cf(z80)); return 8; /* sbc izl */
-
-  case 0xa4: and8(z80, *hptr(rr)); return 8; /* and izh */
-  case 0xa5: and8(z80, *lptr(rr)); return 8; /* and izl */
-
-  case 0xac: xor8(z80, *hptr(rr)); return 8; /* xor izh */
-  case 0xad: xor8(z80, *lptr(rr)); return 8; /* xor izl */
-
-  case 0xb4: or8(z80, *hptr(rr)); return 8; /* or izh */
-  case 0xb5: or8(z80, *lptr(rr)); return 8; /* or izl */
-
-  case 0xbc: cp8(z80, *hptr(rr)); return 8; /* cp izh */
-  case 0xbd: cp8(z80, *lptr(rr)); return 8; /* cp izl */
+  op_case(0x7e) reg(a) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld a, (iz+d) */
+  op_case(0x46) reg(b) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld b, (iz+d) */
+  op_case(0x4e) reg(c) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld c, (iz+d) */
+  op_case(0x56) reg(d) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld d, (iz+d) */
+  op_case(0x5e) reg(e) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld e, (iz+d) */
+  op_case(0x66) reg(h) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld h, (iz+d) */
+  op_case(0x6e) reg(l) = read_byte_at(z80, *rr + (zi8)read_byte(z80)); return 19; /* ld l, (iz+d) */
+
+  op_case(0x70) write_byte_at(z80, reg(b), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), b */
+  op_case(0x71) write_byte_at(z80, reg(c), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), c */
+  op_case(0x72) write_byte_at(z80, reg(d), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), d */
+  op_case(0x73) write_byte_at(z80, reg(e), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), e */
+  op_case(0x74) write_byte_at(z80, reg(h), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), h */
+  op_case(0x75) write_byte_at(z80, reg(l), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), l */
+  op_case(0x77) write_byte_at(z80, reg(a), *rr + (zi8)read_byte(z80)); return 19; /* ld (iz+d), a */
+
+  op_case(0x22) write_word_at(z80, *rr, read_word(z80)); return 20; /* ld (nn), iz */
+  op_case(0xf9) z80->reg.sp = *rr; return 10; /* ld sp, iz */
+
+  op_case(0x21) *rr = read_word(z80); return 14; /* ld iz, nn */
+  op_case(0x2a) *rr = read_word_at(z80, read_word(z80)); return 20; /* ld iz, nn */
+
+  op_case(0xe5) push(z80, *rr); return 15; /* push iz */
+  op_case(0xe1) *rr = pop(z80); return 14; /* pop iz */
+
+  op_case(0x86) add8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80)), 0); return 19; /* add a, (iz+d) */
+  op_case(0x8e) add8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80)), cf(z80)); return 19; /* adc a, (iz+d) */
+  op_case(0x96) sub8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80)), 0); return 19; /* sub a, (iz+d) */
+  op_case(0x9e) sub8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80)), cf(z80)); return 19; /* sbc a, (iz+d) */
+  op_case(0xa6) and8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80))); return 19; /* and (iz+d) */
+  op_case(0xb6) or8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80))); return 19; /* or (iz+d) */
+  op_case(0xae) xor8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80))); return 19; /* xor (iz+d) */
+  op_case(0xbe) cp8(z80, read_byte_at(z80, *rr + (zi8)read_byte(z80))); return 19; /* cp (iz+d) */
+  op_case(0x32) inc_addr(z80, *rr + (zi8)read_byte(z80)); return 23; /* inc (iz+d) */
+  op_case(0x35) dec_addr(z80, *rr + (zi8)read_byte(z80)); return 23; /* dec (iz+d) */
+
+  op_case(0x09) *rr = add16(z80, *rr, bc(z80)); return 15; /* add iz, bc */
+  op_case(0x19) *rr = add16(z80, *rr, de(z80)); return 15; /* add iz, de */
+  op_case(0x29) *rr = add16(z80, *rr, *rr); return 15; /* add iz, iz */
+  op_case(0x39) *rr = add16(z80, *rr, sp(z80)); return 15; /* add iz, sp */
+
+  op_case(0x23) *rr = inc16(z80, *rr); return 10; /* inc iz */
+  op_case(0x2b) *rr = dec16(z80, *rr); return 10; /* dec iz */
+
+  op_case(0xe9) z80->reg.pc = *rr; return 8; /* jp (iz) */
+
+  op_case(0x24) inc8(z80, hptr(rr)); return 8; /* inc izh */
+  op_case(0x25) dec8(z80, hptr(rr)); return 8; /* dec izh */
+  op_case(0x26) *hptr(rr) = read_byte(z80); return 11; /* ld izh, n */
+
+  op_case(0x2c) inc8(z80, lptr(rr)); return 8; /* inc izl */
+  op_case(0x2d) dec8(z80, lptr(rr)); return 8; /* dec izl */
+  op_case(0x2e) *lptr(rr) = read_byte(z80); return 11; /* ld izl, n */
+
+  op_case(0x67) *hptr(rr) = reg(a); return 8; /* ld izh, a */
+  op_case(0x60) *hptr(rr) = reg(b); return 8; /* ld izh, b */
+  op_case(0x61) *hptr(rr) = reg(c); return 8; /* ld izh, c */
+  op_case(0x62) *hptr(rr) = reg(d); return 8; /* ld izh, d */
+  op_case(0x63) *hptr(rr) = reg(e); return 8; /* ld izh, e */
+
+  op_case(0x6f) *lptr(rr) = reg(a); return 8; /* ld izl, a */
+  op_case(0x68) *lptr(rr) = reg(b); return 8; /* ld izl, b */
+  op_case(0x69) *lptr(rr) = reg(c); return 8; /* ld izl, c */
+  op_case(0x6a) *lptr(rr) = reg(d); return 8; /* ld izl, d */
+  op_case(0x6b) *lptr(rr) = reg(e); return 8; /* ld izl, e */
+
+  op_case(0x7c) reg(a) = *hptr(rr); return 8; /* ld a, izh */
+  op_case(0x44) reg(b) = *hptr(rr); return 8; /* ld b, izh */
+  op_case(0x4c) reg(c) = *hptr(rr); return 8; /* ld c, izh */
+  op_case(0x54) reg(d) = *hptr(rr); return 8; /* ld d, izh */
+  op_case(0x5c) reg(e) = *hptr(rr); return 8; /* ld e, izh */
+
+  op_case(0x7d) reg(a) = *lptr(rr); return 8; /* ld a, izl */
+  op_case(0x45) reg(b) = *lptr(rr); return 8; /* ld b, izl */
+  op_case(0x4d) reg(c) = *lptr(rr); return 8; /* ld c, izl */
+  op_case(0x55) reg(d) = *lptr(rr); return 8; /* ld d, izl */
+  op_case(0x5d) reg(e) = *lptr(rr); return 8; /* ld e, izl */
+
+  op_case(0x64) *hptr(rr) = *hptr(rr); return 8; /* ld izh, izh */
+  op_case(0x65) *hptr(rr) = *lptr(rr); return 8; /* ld izh, izl */
+  op_case(0x6c) *lptr(rr) = *hptr(rr); return 8; /* ld izl, izh */
+  op_case(0x6d) *lptr(rr) = *hptr(rr); return 8; /* ld izl, izl */
+
+  op_case(0x84) add8(z80, *hptr(rr), 0); return 8; /* add a, izh */
+  op_case(0x85) add8(z80, *lptr(rr), 0); return 8; /* add a, izl */
+
+  op_case(0x8c) add8(z80, *hptr(rr), cf(z80)); return 8; /* adc a, izh */
+  op_case(0x8d) add8(z80, *lptr(rr), cf(z80)); return 8; /* adc a, izl */
+
+  op_case(0x94) sub8(z80, *hptr(rr), 0); return 8; /* sub izh */
+  op_case(0x95) sub8(z80, *lptr(rr), 0); return 8; /* sub izl */
+
+  op_case(0x9c) sub8(z80, *hptr(rr), cf(z80)); return 8; /* sbc izh */
+  op_case(0x9d) sub8(z80, *lptr(rr), cf(z80)); return 8; /* sbc izl */
+
+  op_case(0xa4) and8(z80, *hptr(rr)); return 8; /* and izh */
+  op_case(0xa5) and8(z80, *lptr(rr)); return 8; /* and izl */
+
+  op_case(0xac) xor8(z80, *hptr(rr)); return 8; /* xor izh */
+  op_case(0xad) xor8(z80, *lptr(rr)); return 8; /* xor izl */
+
+  op_case(0xb4) or8(z80, *hptr(rr)); return 8; /* or izh */
+  op_case(0xb5) or8(z80, *lptr(rr)); return 8; /* or izl */
+
+  op_case(0xbc) cp8(z80, *hptr(rr)); return 8; /* cp izh */
+  op_case(0xbd) cp8(z80, *lptr(rr)); return 8; /* cp izl */
 
     /* clang-format on */
 
-  case 0x36: /* ld (iz+d), n */
+  op_case(0x36) /* ld (iz+d), n */
     z80->state.tmp = read_byte(z80);
     write_byte_at(z80, read_byte(z80), *rr + (zi8)z80->state.tmp);
     return 19;
 
-  case 0xe3: /* ex (sp), iz */
+  op_case(0xe3) /* ex (sp), iz */
     z80->state.tmp = read_word_at(z80, z80->reg.sp);
     write_word_at(z80, *rr, z80->reg.sp);
     *rr = z80->state.tmp;
     return 23;
 
-  case 0xcb:
+  op_case(0xcb)
     tmp = *rr + (zi8)read_byte(z80); /* iz+d */
     return z80e_execute_cb(z80, read_byte(z80), tmp, 1);
 
-  default:
+  op_default
     z80->reg.pc -= 2;
     return Z80E_INVALID_OPCODE;
   }
 }
 
 static void dec8(z80e* z80, zu8* reg) {
-  set_hf(z80, u8_half_borrow(*reg, 1));
-  set_cf(z80, borrow(8, *reg, 1, 0));
-  set_pof(z80, cf(z80));
+  reg(f) = dec_flags[*reg];
   *reg -= 1;
-  set_sf(z80, u8_negative(*reg));
-  set_zf(z80, *reg == 0);
-  set_nf(z80, 1); /* Add = 0/Subtract = 1 */
-  set_yf(z80, bit(*reg, 5));
-  set_xf(z80, bit(*reg, 3));
 }
 
 static void inc8(z80e* z80, zu8* reg) {
-  set_cf(z80, u8_overflow(*reg, 1));
-  set_pof(z80, cf(z80));
-  set_hf(z80, u8_half_carry(*reg, 1));
+  reg(f) = inc_flags[*reg];
   *reg += 1;
-  set_sf(z80, u8_negative(*reg));
-  set_zf(z80, *reg == 0);
-  set_yf(z80, bit(*reg, 5));
-  set_xf(z80, bit(*reg, 3));
-  set_nf(z80, 0); /* Add = 0/Subtract = 1 */
 }
 
 static void add8(z80e* z80, zu8 v, zu8 c) {
-  set_cf(z80, carry(8, reg(a), v, c));
-  set_pof(z80, cf(z80));
-  set_hf(z80, carry(4, reg(a), v, c));
+  zu8 cy = carry(8, reg(a), v, c);
+  zu8 h = carry(4, reg(a), v, c);
   reg(a) = reg(a) + v + c;
-  set_sf(z80, u8_negative(reg(a)));
-  set_zf(z80, reg(a) == 0);
-  set_yf(z80, bit(reg(a), 5));
-  set_xf(z80, bit(reg(a), 3));
-  set_nf(z80, 0); /* Add = 0/Subtract = 1 */
+  /* P/V is derived from the carry; bit 0 is CF, bit 2 is P/V */
+  reg(f) = szyx_table[reg(a)] | (h << 4) | (cy ? 0x05 : 0);
 }
 
 static void sub8(z80e* z80, zu8 v, zu8 c) {
-  set_cf(z80, borrow(8, reg(a), v, c));
-  set_pof(z80, cf(z80));
-  set_hf(z80, borrow(4, reg(a), v, c));
+  zu8 cy = borrow(8, reg(a), v, c);
+  zu8 h = borrow(4, reg(a), v, c);
   reg(a) = reg(a) - (v + c);
-  set_sf(z80, u8_negative(reg(a)));
-  set_zf(z80, reg(a) == 0);
-  set_yf(z80, bit(reg(a), 5));
-  set_xf(z80, bit(reg(a), 3));
-  set_nf(z80, 1); /* Add = 0/Subtract = 1 */
+  reg(f) = szyx_table[reg(a)] | (h << 4) | (cy ? 0x05 : 0) | 0x02;
 }
 
 static void and8(z80e* z80, zu8 v) {
   reg(a) = reg(a) & v;
-  set_sf(z80, u8_negative(reg(a)));
-  set_zf(z80, reg(a) == 0);
-  set_hf(z80, 1);
-  set_pof(z80, is_even_parity(reg(a)));
-  set_yf(z80, bit(reg(a), 5));
-  set_xf(z80, bit(reg(a), 3));
-  set_nf(z80, 0);
-  set_cf(z80, 0);
+  reg(f) = szyx_table[reg(a)] | parity_table[reg(a)] | 0x10;
 }
 
 static void or8(z80e* z80, zu8 v) {
   reg(a) = reg(a) | v;
-  set_sf(z80, u8_negative(reg(a)));
-  set_zf(z80, reg(a) == 0);
-  set_yf(z80, bit(reg(a), 5));
-  set_hf(z80, 0);
-  set_xf(z80, bit(reg(a), 3));
-  set_pof(z80, is_even_parity(reg(a)));
-  set_nf(z80, 0);
-  set_cf(z80, 0);
+  reg(f) = szyx_table[reg(a)] | parity_table[reg(a)];
 }
 
 static void xor8(z80e* z80, zu8 v) {
   reg(a) = reg(a) ^ v;
-  set_sf(z80, (reg(a) & 0x80) != 0); /* Is negative */
-  set_zf(z80, reg(a) == 0);
-  set_hf(z80, 0);
-  set_pof(z80, is_even_parity(reg(a)));
-  set_yf(z80, bit(reg(a), 5));
-  set_xf(z80, bit(reg(a), 3));
-  set_nf(z80, 0);
-  set_cf(z80, 0);
+  reg(f) = szyx_table[reg(a)] | parity_table[reg(a)];
 }
 
 static void cp8(z80e* z80, zu8 v) {
+  zu8 h = u8_half_borrow(reg(a), v);
+  zu8 cy = borrow(8, reg(a), v, 0);
   z80->state.tmp = reg(a) - v;
-  set_hf(z80, u8_half_borrow(reg(a), v));
-  set_cf(z80, borrow(8, reg(a), v, 0));
-  set_pof(z80, cf(z80));
-  set_sf(z80, u8_negative(z80->state.tmp));
-  set_zf(z80, reg(a) == v);
-  set_yf(z80, bit(z80->state.tmp, 5));
-  set_xf(z80, bit(z80->state.tmp, 3));
-  set_nf(z80, 1);
+  reg(f) = szyx_table[(zu8)z80->state.tmp] | (h << 4) | (cy ? 0x05 : 0) | 0x02;
 }
 
 static void inc_addr(z80e* z80, zu16 addr) {
@@ -1234,8 +1899,30 @@ static zu8 ldi(z80e* z80) {
   return 16;
 }
 
-static zu8 lddr(z80e* z80) {
+/* The repeating block instructions re-execute themselves by rewinding the
+ * PC, paying an opcode refetch and a dispatch per iteration. In flat memory
+ * mode no host observes the individual accesses, so the whole repeat is run
+ * in one call instead; the callback path keeps stepping. */
+
+/* A repeat that writes over its own opcode bytes must leave the batch and
+ * fall back to the rewind-and-refetch stepping, or the batch would keep
+ * repeating an instruction that no longer exists in memory */
+#define repeat_clobbered(written) ((zu16)(written) == (zu16)(z80->reg.pc - 2) || (zu16)(written) == (zu16)(z80->reg.pc - 1))
+
+static zi32 lddr(z80e* z80) {
   ldd(z80);
+  if (z80->mem) {
+    zi32 total = 0;
+    while (bc(z80) != 0) {
+      if (repeat_clobbered(de(z80) + 1)) {
+        z80->reg.pc -= 2;
+        return total + 21;
+      }
+      total += 21;
+      ldd(z80);
+    }
+    return total + 16;
+  }
   if (bc(z80) != 0) {
     z80->reg.pc -= 2;
     return 21;
@@ -1243,8 +1930,20 @@ static zu8 lddr(z80e* z80) {
   return 16;
 }
 
-static zu8 ldir(z80e* z80) {
+static zi32 ldir(z80e* z80) {
   ldi(z80);
+  if (z80->mem) {
+    zi32 total = 0;
+    while (bc(z80) != 0) {
+      if (repeat_clobbered(de(z80) - 1)) {
+        z80->reg.pc -= 2;
+        return total + 21;
+      }
+      total += 21;
+      ldi(z80);
+    }
+    return total + 16;
+  }
   if (bc(z80) != 0) {
     z80->reg.pc -= 2;
     return 21;
@@ -1271,8 +1970,16 @@ static zu8 cpi(z80e* z80) {
   return 16;
 }
 
-static zu8 cpir(z80e* z80) {
+static zi32 cpir(z80e* z80) {
   cpi(z80);
+  if (z80->mem) {
+    zi32 total = 16;
+    while (bc(z80) != 0 && z80->state.tmp != 0) {
+      cpi(z80);
+      total += 21;
+    }
+    return total;
+  }
   if (bc(z80) == 0 || z80->state.tmp == 0) {
     return 16;
   }
@@ -1299,8 +2006,16 @@ static zu8 cpd(z80e* z80) {
   return 16;
 }
 
-static zu8 cpdr(z80e* z80) {
+static zi32 cpdr(z80e* z80) {
   cpd(z80);
+  if (z80->mem) {
+    zi32 total = 16;
+    while (bc(z80) != 0 && z80->state.tmp != 0) {
+      cpd(z80);
+      total += 21;
+    }
+    return total;
+  }
   if (bc(z80) == 0 || z80->state.tmp == 0) {
     return 16;
   }
@@ -1312,13 +2027,7 @@ static zu8 cpdr(z80e* z80) {
   zu8 b = read_byte_at(z80, hl(z80)), tmp = reg(a);                                                                    \
   code;                                                                                                                \
   write_byte_at(z80, b, hl(z80));                                                                                      \
-  set_sf(z80, bit(reg(a), 7));                                                                                         \
-  set_zf(z80, reg(a) == 0);                                                                                            \
-  set_yf(z80, bit(reg(a), 5));                                                                                         \
-  set_hf(z80, 0);                                                                                                      \
-  set_xf(z80, bit(reg(a), 3));                                                                                         \
-  set_pof(z80, is_even_parity(reg(a)));                                                                                \
-  set_nf(z80, 0);
+  reg(f) = (reg(f) & 0x01) | szyx_table[reg(a)] | parity_table[reg(a)];
 
 static void rld(z80e* z80) {
   rrdrld({
@@ -1402,11 +2111,8 @@ static void daa(z80e* z80) {
     set_hf(z80, low > 0x9);
   }
 
-  set_sf(z80, bit(reg(a), 7));
-  set_zf(z80, reg(a) == 0);
-  set_yf(z80, bit(reg(a), 5));
-  set_xf(z80, bit(reg(a), 3));
-  set_pof(z80, is_even_parity(reg(a)));
+  /* HF (just computed), NF and CF are preserved */
+  reg(f) = (reg(f) & 0x13) | szyx_table[reg(a)] | parity_table[reg(a)];
 }
 
 static void cpl(z80e* z80) {
@@ -1440,16 +2146,8 @@ static void scf(z80e* z80) {
   set_cf(z80, 1);
 }
 
-#define rs_set_registers(n)                                                                                            \
-  do {                                                                                                                 \
-    set_sf(z80, bit(n, 7));                                                                                            \
-    set_zf(z80, n == 0);                                                                                               \
-    set_yf(z80, bit(n, 5));                                                                                            \
-    set_hf(z80, 0);                                                                                                    \
-    set_xf(z80, bit(n, 3));                                                                                            \
-    set_pof(z80, is_even_parity(n));                                                                                   \
-    set_nf(z80, 0);                                                                                                    \
-  } while (0)
+/* CF is set by the caller and preserved here */
+#define rs_set_registers(n) (reg(f) = (reg(f) & 0x01) | szyx_table[n] | parity_table[n])
 
 static void rlc(z80e* z80, zu8* r, zu16 addr, zu8 undoc_behavior) {
   zu8 src = (undoc_behavior ? read_byte_at(z80, addr) : *r);
@@ -1575,8 +2273,23 @@ static void in_id(z80e* z80, int mode) {
   set_nf(z80, 1);
 }
 
-static zi8 inr(z80e* z80, int mode) {
+static zi32 inr(z80e* z80, int mode) {
   in_id(z80, mode);
+  /* While the IO log is armed the repeat is stepped, not batched: a batch
+   * with more reads than the log has room for would rewind forever, while
+   * stepped iterations retire one read at a time across chunk boundaries */
+  if (z80->mem && !z80->iolog) {
+    zi32 total = 0;
+    while (reg(b) != 0) {
+      if (repeat_clobbered(hl(z80) + (mode ? 1 : -1))) {
+        z80->reg.pc -= 2;
+        return total + 21;
+      }
+      total += 21;
+      in_id(z80, mode);
+    }
+    return total + 16;
+  }
   if (reg(b) == 0) {
     return 16;
   }
@@ -1593,8 +2306,16 @@ static void out_id(z80e* z80, int mode) {
   set_nf(z80, 1);
 }
 
-static zi8 outr(z80e* z80, int mode) {
+static zi32 outr(z80e* z80, int mode) {
   out_id(z80, mode);
+  if (z80->mem) {
+    zi32 total = 16;
+    while (reg(b) != 0) {
+      out_id(z80, mode);
+      total += 21;
+    }
+    return total;
+  }
   if (reg(b) == 0) {
     return 16;
   }
@@ -1602,52 +2323,101 @@ static zi8 outr(z80e* z80, int mode) {
   return 21;
 }
 
-static void set_bc(z80e* z80, zu16 val) {
-  reg(b) = val >> 8;
-  reg(c) = val;
-}
+static void set_bc(z80e* z80, zu16 val) { reg(bc) = val; }
 
-static void set_hl(z80e* z80, zu16 val) {
-  reg(h) = val >> 8;
-  reg(l) = val;
-}
+static void set_hl(z80e* z80, zu16 val) { reg(hl) = val; }
 
-static void set_de(z80e* z80, zu16 val) {
-  reg(d) = val >> 8;
-  reg(e) = val;
-}
+static void set_de(z80e* z80, zu16 val) { reg(de) = val; }
 
 static void set_sp(z80e* z80, zu16 val) { z80->reg.sp = val; }
 
-static void set_af(z80e* z80, zu16 val) {
-  reg(a) = val >> 8;
-  reg(f) = val;
-}
+static void set_af(z80e* z80, zu16 val) { reg(af) = val; }
 
 static zu8 read_byte(z80e* z80) {
-  zu8 b = z80->memread(z80->reg.pc, z80->ctx);
+  zu8 b;
+
+  if (z80->pd_serve) {
+    if (z80->pd_pos < z80->pd_serve->len) {
+      z80->reg.pc += 1;
+      return z80->pd_serve->bytes[z80->pd_pos++];
+    }
+    /* The first execution fetched fewer bytes (e.g. an untaken jr) */
+    z80->pd_serve = 0;
+  }
+
+  b = read_byte_at(z80, z80->reg.pc);
+  if (z80->pd_fill && z80->pd_fill->len < 4) {
+    z80->pd_fill->bytes[z80->pd_fill->len++] = b;
+  }
   z80->reg.pc += 1;
   return b;
 }
 
-static zu8 read_byte_at(z80e* z80, zu16 addr) { return z80->memread(addr, z80->ctx); }
+static zu8 read_byte_at(z80e* z80, zu16 addr) {
+  z80e_page const* pg = &z80->page[addr >> 8];
+  if (pg->ptr) {
+    return pg->ptr[addr & 0xff];
+  }
+  if ((zu32)(addr - z80->rom_base) < z80->rom_size) {
+    return z80->rom[addr - z80->rom_base];
+  }
+  if (z80->mem) {
+    return z80->mem[addr];
+  }
+  return z80->memread(addr, z80->ctx);
+}
 
 static zu16 read_word(z80e* z80) {
-  zu8 lsb = z80->memread(z80->reg.pc, z80->ctx);
-  z80->reg.pc += 1;
-  zu8 msb = z80->memread(z80->reg.pc, z80->ctx);
-  z80->reg.pc += 1;
+  zu8 lsb = read_byte(z80);
+  zu8 msb = read_byte(z80);
   return msb << 8 | lsb;
 }
 
 static zu16 read_word_at(z80e* z80, zu16 addr) { return read_byte_at(z80, addr) | (read_byte_at(z80, addr + 1) << 8); }
 
 static void write_byte(z80e* z80, zu8 byte) {
-  z80->memwrite(z80->reg.pc, byte, z80->ctx);
+  write_byte_at(z80, byte, z80->reg.pc);
   z80->reg.pc += 1;
 }
 
-static void write_byte_at(z80e* z80, zu8 byte, zu16 addr) { z80->memwrite(addr, byte, z80->ctx); }
+static void write_byte_at(z80e* z80, zu8 byte, zu16 addr) {
+  if (z80->iolog && z80->error) {
+    return; /* The instruction is being rewound; see io_read_byte */
+  }
+  if (z80->watch_mask[addr >> 3] & (1 << (addr & 7))) {
+    z80->watch_fn(z80, addr, byte, z80->watch_ctx);
+  }
+  store_byte(z80, byte, addr);
+}
+
+/* The write path below the watchpoint hook; z80e_checkpoint_apply enters
+ * here so restores are not observed as stores */
+static void store_byte(z80e* z80, zu8 byte, zu16 addr) {
+  z80e_page const* pg = &z80->page[addr >> 8];
+  if (pg->ptr) {
+    if (pg->flags & Z80E_PAGE_RO) {
+      return;
+    }
+    if (z80->pcache_enabled) {
+      predecode_invalidate(z80, addr);
+    }
+    pg->ptr[addr & 0xff] = byte;
+    z80->dirty[addr >> 11] |= 1 << ((addr >> 8) & 7);
+    return;
+  }
+  if ((zu32)(addr - z80->rom_base) < z80->rom_size) {
+    return; /* Stores into ROM are dropped */
+  }
+  z80->dirty[addr >> 11] |= 1 << ((addr >> 8) & 7);
+  if (z80->mem) {
+    z80->mem[addr] = byte;
+    return;
+  }
+  if (z80->pcache_enabled) {
+    predecode_invalidate(z80, addr);
+  }
+  z80->memwrite(addr, byte, z80->ctx);
+}
 
 static void write_word(z80e* z80, zu16 word) {
   write_byte(z80, word);
@@ -1661,10 +2431,45 @@ static void write_word_at(z80e* z80, zu16 word, zu16 addr) {
 
 static zu8 io_read_byte(z80e* z80, zu8 port, zu8 byte) {
   zu16 addr = ((zu16)byte << 8) | port;
+
+  if (z80->iolog) {
+    /* A log-boundary error already latched in this instruction: the whole
+     * instruction is rewound, so do not touch the host or the log */
+    if (z80->error) {
+      return 0xff;
+    }
+    if (z80->iolog_pos == z80->iolog_cap) {
+      /* Latched before the read happens, so it is neither lost (record)
+       * nor guessed at (replay); the instruction rewind re-executes it
+       * against the next chunk */
+      z80->error = Z80E_IOLOG_FULL;
+      return 0xff;
+    }
+    if (z80->iolog_replay) {
+      z80e_io_record* rec = &z80->iolog[z80->iolog_pos++];
+      if (rec->port != addr || rec->tstate_lo != (zu32)z80->tstates) {
+        z80->error = Z80E_IOLOG_DIVERGED;
+        return 0xff;
+      }
+      return rec->value;
+    }
+
+    zu8 value = z80->ioread(addr, byte, z80->ctx);
+    z80e_io_record* rec = &z80->iolog[z80->iolog_pos++];
+    rec->tstate_lo = (zu32)z80->tstates;
+    rec->port = addr;
+    rec->value = value;
+    rec->pad = 0;
+    return value;
+  }
+
   return z80->ioread(addr, byte, z80->ctx);
 }
 
 static void io_write_byte(z80e* z80, zu8 port, zu8 msb, zu8 byte) {
   zu16 addr = ((zu16)msb << 8) | port;
+  if (z80->iolog && z80->error) {
+    return; /* The instruction is being rewound; see io_read_byte */
+  }
   z80->iowrite(addr, byte, z80->ctx);
 }
@@ -7,46 +7,195 @@ typedef short zi16;
 typedef unsigned short zu16;
 typedef int zi32;
 typedef unsigned int zu32;
+typedef long long zi64;
+typedef unsigned long long zu64;
 
 typedef zu8 (*z80e_memread_fn_t)(zu32 addr, void* ctx);
 typedef void (*z80e_memwrite_fn_t)(zu32 addr, zu8 byte, void* ctx);
 typedef zu8 (*z80e_ioread_fn_t)(zu16 addr, zu8 byte, void* ctx);
 typedef void (*z80e_iowrite_fn_t)(zu16 addr, zu8 byte, void* ctx);
 
-typedef struct {
-  zu8 a;
-  zu8 b;
-  zu8 d;
-  zu8 h;
-
-  /* Flag register
-   *
-   * Flag bits: S Z Y H X P/V N C
-   *
-   * - S   - Sign flag
-   * - Z   - Zero flag
-   * - Y   - Copy of 5th bit of the result (undocumented)
-   * - H   - Half-carry flag
-   * - X   - Copy of 3rd bit of the result (undocumented)
-   * - P/V - Parity/Overflow flag
-   * - N   - Add/Subtract flag
-   * - C   - Carry flag
-   */
-  zu8 f;
+struct z80e;
+typedef void (*z80e_event_fn_t)(struct z80e* z80, void* ctx);
+typedef void (*z80e_watch_fn_t)(struct z80e* z80, zu16 addr, zu8 byte, void* ctx);
+typedef void (*z80e_writer_fn_t)(zu8 const* data, zu32 len, void* ctx);
 
-  zu8 c;
-  zu8 e;
-  zu8 l;
+/* Register file
+ *
+ * Each pair is stored as a native 16-bit word with endian-correct byte
+ * views, so 16-bit operations are plain loads and stores instead of
+ * shift-and-or reassembly of the halves.
+ *
+ * Flag register `f`
+ *
+ * Flag bits: S Z Y H X P/V N C
+ *
+ * - S   - Sign flag
+ * - Z   - Zero flag
+ * - Y   - Copy of 5th bit of the result (undocumented)
+ * - H   - Half-carry flag
+ * - X   - Copy of 3rd bit of the result (undocumented)
+ * - P/V - Parity/Overflow flag
+ * - N   - Add/Subtract flag
+ * - C   - Carry flag
+ */
+typedef struct {
+#if defined(LITTLE_ENDIAN) || defined(__LITTLE_ENDIAN__)
+  union {
+    zu16 af;
+    struct {
+      zu8 f;
+      zu8 a;
+    };
+  };
+  union {
+    zu16 bc;
+    struct {
+      zu8 c;
+      zu8 b;
+    };
+  };
+  union {
+    zu16 de;
+    struct {
+      zu8 e;
+      zu8 d;
+    };
+  };
+  union {
+    zu16 hl;
+    struct {
+      zu8 l;
+      zu8 h;
+    };
+  };
+#elif defined(BIG_ENDIAN) || defined(__BIG_ENDIAN__)
+  union {
+    zu16 af;
+    struct {
+      zu8 a;
+      zu8 f;
+    };
+  };
+  union {
+    zu16 bc;
+    struct {
+      zu8 b;
+      zu8 c;
+    };
+  };
+  union {
+    zu16 de;
+    struct {
+      zu8 d;
+      zu8 e;
+    };
+  };
+  union {
+    zu16 hl;
+    struct {
+      zu8 h;
+      zu8 l;
+    };
+  };
+#else
+#error "Neither LITTLE_ENDIAN nor BIG_ENDIAN is defined"
+#endif
 } z80e_registers;
 
 typedef struct {
   zu16 tmp;
 } z80e_state;
 
+/* One slot of the predecode cache: the bytes an instruction at `pc` fetched
+ * on its first execution, so hot loops replay them without going through the
+ * memread callback again. */
+typedef struct {
+  zu16 pc;
+  zu8 len;
+  zu8 valid;
+  zu8 bytes[4]; /*< A Z80 instruction is at most 4 bytes long */
+} z80e_predecode_entry;
+
+#ifdef Z80E_PROFILE
+/* Execution profile, compiled in with the Z80E_PROFILE build option
+ *
+ * Counts every dispatched opcode per prefix table and every instruction
+ * fetch per address. Zeroed by z80e_init; read the fields directly and use
+ * z80e_profile_reset to start a new measurement window. */
+typedef struct {
+  zu32 opcode[256];      /*< Unprefixed opcodes */
+  zu32 opcode_cb[256];   /*< CB-prefixed opcodes */
+  zu32 opcode_ed[256];   /*< ED-prefixed opcodes */
+  zu32 opcode_ddfd[256]; /*< DD- and FD-prefixed opcodes, combined */
+  zu32 pc[0x10000];      /*< Instruction fetches per address */
+} z80e_profile;
+#endif
+
+#ifdef Z80E_TRACE
+/* One record of the execution trace, written per instruction fetch
+ *
+ * Fixed size, no formatting: one store per instruction keeps the trace
+ * cheap enough to stay enabled in production. */
+typedef struct {
+  zu64 cycle; /*< T-state counter at the fetch */
+  zu16 pc;
+  zu16 af;
+  zu16 hl;
+  zu16 sp;
+  zu8 opcode; /*< First opcode byte */
+} z80e_trace_record;
+
+/* Trace ring state, compiled in with the Z80E_TRACE build option
+ *
+ * While disabled every record lands in `scratch`, so the run loop stores
+ * unconditionally instead of branching on an enable flag. */
+typedef struct {
+  z80e_trace_record* buf;
+  zu32 mask; /*< Ring size - 1; the size is a power of two */
+  zu32 pos;  /*< Records written; the ring index is pos & mask */
+  z80e_trace_record scratch;
+} z80e_trace;
+#endif
+
+/* One record of the IO-read log
+ *
+ * A log is a flat array of these; that array is also the streaming file
+ * format - append filled buffers to a file as they fill up and re-arm
+ * recording with a fresh buffer. `tstate_lo` and `port` let a replay detect
+ * the exact read where a run diverged from the recording. */
+typedef struct {
+  zu32 tstate_lo; /*< Low 32 bits of the T-state counter at the read */
+  zu16 port;      /*< Full 16-bit port address */
+  zu8 value;      /*< Byte the ioread callback returned */
+  zu8 pad;
+} z80e_io_record;
+
+#define Z80E_PAGE_SIZE 0x100
+#define Z80E_PAGE_COUNT 0x100
+
+#define Z80E_PAGE_RO 0x01 /*< Writes into the page are silently dropped */
+
+/* One entry of the page table
+ *
+ * Accesses to a page with a non-NULL `ptr` are direct loads and stores into
+ * it; a NULL `ptr` routes the page to the ROM mapping, the flat memory or
+ * the callbacks, in that order. */
+typedef struct {
+  zu8* ptr;
+  zu8 flags;
+} z80e_page;
+
+/* Size of the blob produced by z80e_save */
+#define Z80E_SNAPSHOT_SIZE 46
+
 typedef enum {
   Z80E_OK = 0,
   Z80E_DAA_INVALID_VALUE = -1,
   Z80E_INVALID_OPCODE = -2,
+  Z80E_IOLOG_FULL = -3,     /*< Record buffer full, or replay log exhausted */
+  Z80E_IOLOG_DIVERGED = -4, /*< Replayed read does not match the recording */
+  Z80E_HOST_ABORT = -5,     /*< Latched by the host (e.g. from a callback) to stop a batched run */
 } z80_error_code;
 
 struct z80e {
@@ -68,6 +217,10 @@ struct z80e {
   zu8 halt;
   zu8 iff;
   zu8 int_mode;
+  zu8 int_pending; /*< INT line asserted; held until accepted */
+  zu8 int_bus;     /*< Byte the device drives onto the bus for the acknowledge cycle */
+  zu8 nmi_pending; /*< NMI line asserted */
+  zu8 ei_shadow;   /*< Interrupts stay blocked for the instruction after ei */
   z80e_state state;
 
   z80e_memread_fn_t memread;
@@ -76,6 +229,46 @@ struct z80e {
   z80e_iowrite_fn_t iowrite;
   void* ctx;
 
+  zu8* mem; /*< Flat 64 KB memory; NULL when the callbacks are used */
+
+  zu8 const* rom; /*< Mapped ROM image; see z80e_map_rom */
+  zu16 rom_base;  /*< First address covered by the ROM */
+  zu32 rom_size;  /*< 0 when no ROM is mapped */
+
+  z80e_page page[Z80E_PAGE_COUNT]; /*< Page table, indexed by the high address byte */
+
+  z80e_watch_fn_t watch_fn; /*< Shared by all watched ranges; NULL when none */
+  void* watch_ctx;
+  zu8 watch_mask[0x2000]; /*< One bit per address; see z80e_watch */
+
+  zu8 dirty[0x20]; /*< One bit per 256-byte page written since the last checkpoint */
+
+  zu64 tstates; /*< T-states elapsed since z80e_init */
+
+  zu64 event_at;            /*< T-state the pending event fires at */
+  z80e_event_fn_t event_fn; /*< Pending event; NULL when none */
+  void* event_ctx;
+
+  z80e_io_record* iolog; /*< IO-read log; NULL when record/replay is off */
+  zu32 iolog_cap;        /*< Buffer capacity (record) or log length (replay) */
+  zu32 iolog_pos;
+  zu8 iolog_replay;                    /*< 0 - recording, 1 - replaying, when iolog is set */
+  zu8 iolog_undo[Z80E_SNAPSHOT_SIZE];  /*< Instruction-start state, for the log-boundary rewind */
+
+  z80e_predecode_entry pcache[256]; /*< Direct-mapped, indexed by low PC byte */
+  zu8 pcache_enabled;
+  z80e_predecode_entry* pd_serve; /*< Entry the current instruction replays from */
+  z80e_predecode_entry* pd_fill;  /*< Entry the current instruction records into */
+  zu8 pd_pos;                     /*< Replay position within pd_serve */
+
+#ifdef Z80E_PROFILE
+  z80e_profile profile;
+#endif
+
+#ifdef Z80E_TRACE
+  z80e_trace trace;
+#endif
+
   z80_error_code error;
 };
 
@@ -85,13 +278,245 @@ struct z80e_config {
   z80e_ioread_fn_t ioread;
   z80e_iowrite_fn_t iowrite;
   void* ctx;
+
+  /* Flat memory mode
+   *
+   * When `mem` points to a 64 KB buffer, the core reads and writes it
+   * directly and never calls `memread`/`memwrite`. Use it when the emulated
+   * machine is plain RAM and per-access observation is not needed; keep the
+   * callbacks for banked or observed memory.
+   */
+  zu8* mem;
+
+  /* Predecode cache
+   *
+   * When non-zero, instruction bytes are cached keyed by PC on first
+   * execution and replayed on later executions, so hot loops skip the
+   * memread callback for fetches. Writes through the core invalidate
+   * affected entries; if the host modifies memory behind the core's back it
+   * must call z80e_predecode_flush. Ignored in flat memory mode, where
+   * fetches are already direct loads.
+   */
+  zu8 predecode;
 };
 
 typedef struct z80e z80e;
 typedef struct z80e_config z80e_config;
 
 void z80e_init(z80e* z80, z80e_config* config);
-zi8 z80e_instruction(z80e* z80);
+zi32 z80e_instruction(z80e* z80);
+
+/* Execute instructions until at least `tstates` T-states have elapsed
+ *
+ * Dispatches instructions in an internal loop, so the per-instruction call
+ * and error/halt bookkeeping are not paid by the host. While the CPU is
+ * halted the budget is consumed in one step (in whole 4 T-state halt NOPs)
+ * instead of being spun away; a scheduled event can wake the CPU by
+ * clearing `halt`. Stops early on error; the error is latched in
+ * `z80->error`.
+ *
+ * @returns the number of T-states actually consumed
+ */
+zu32 z80e_run(z80e* z80, zu32 tstates);
+
+/* Execute instructions until the T-state counter reaches `tstate`
+ *
+ * The counter `z80->tstates` accumulates across calls, so a scheduler can
+ * drive the core to absolute points on its timeline instead of re-deriving
+ * budgets from per-call deltas. Halted time is fast-forwarded the same way
+ * as in z80e_run. Stops early on error.
+ *
+ * @returns the number of T-states actually consumed; the count wraps on
+ * runs longer than 2^32 T-states - read `z80->tstates` for the absolute
+ * position
+ */
+zu32 z80e_run_until(z80e* z80, zu64 tstate);
+
+/* Schedule a one-shot event at an absolute T-state
+ *
+ * The run loop invokes `fn` from inside z80e_run/z80e_run_until as soon as
+ * the T-state counter reaches `tstate`, so the host does not have to poll
+ * between instructions. The event is cleared before `fn` runs; the callback
+ * may reschedule itself, deliver an interrupt with z80e_int/z80e_nmi, or
+ * stop execution with z80e_halt. Passing a NULL `fn` cancels the pending
+ * event. z80e_instruction does not check the schedule.
+ */
+void z80e_schedule(z80e* z80, zu64 tstate, z80e_event_fn_t fn, void* ctx);
+
+/* Assert the maskable interrupt line
+ *
+ * The line is latched and accepted at the next instruction boundary once
+ * interrupts are enabled, waking a halted CPU; until then it stays pending,
+ * like the level-triggered hardware line. `bus_value` is the byte the device
+ * drives onto the bus during the acknowledge cycle: the low vector byte in
+ * mode 2, an opcode (normally an rst) executed in mode 0; mode 1 ignores it.
+ * Acceptance after ei is delayed by one instruction, so a handler can finish
+ * with ei; reti without being re-entered. Pending lines are not part of a
+ * z80e_save snapshot - the host re-asserts them after a restore.
+ */
+void z80e_int(z80e* z80, zu8 bus_value);
+
+/* Assert the non-maskable interrupt line
+ *
+ * Accepted at the next instruction boundary regardless of the interrupt
+ * enable state, waking a halted CPU: the return address is pushed and
+ * execution continues at 0x0066. iff1 is cleared while iff2 keeps the
+ * pre-interrupt enable state, which retn restores.
+ */
+void z80e_nmi(z80e* z80);
+
+/* Start recording IO reads into `log`
+ *
+ * Every io read result is appended as a z80e_io_record. A read that finds
+ * the buffer full is not performed: Z80E_IOLOG_FULL is latched and the
+ * instruction is rewound to its start with all of its side effects
+ * discarded, so the host flushes the buffer, calls z80e_record again and
+ * resumes - the boundary read then executes and is logged as the first
+ * record of the next chunk. The core is deterministic apart from these
+ * reads, so the concatenated chunks are a complete reproduction recipe for
+ * a run started from the same state and memory.
+ */
+void z80e_record(z80e* z80, z80e_io_record* log, zu32 capacity);
+
+/* Replay a recorded IO-read log
+ *
+ * IO reads are served from `log` instead of the ioread callback, so a
+ * recorded run replays at full speed with no host I/O. Each read is checked
+ * against the recorded T-state counter and port; on mismatch
+ * Z80E_IOLOG_DIVERGED is latched and `iolog_pos` points one past the
+ * offending record. Running off the end of the log latches Z80E_IOLOG_FULL
+ * and rewinds the instruction without consuming the read, mirroring the
+ * recording side, so the host feeds the next chunk with z80e_replay and
+ * resumes.
+ */
+void z80e_replay(z80e* z80, z80e_io_record const* log, zu32 length);
+
+/* Stop recording or replaying
+ *
+ * @returns the number of records written (record mode) or consumed (replay)
+ */
+zu32 z80e_record_stop(z80e* z80);
+
+/* Serialize the architectural state into `buf`
+ *
+ * Writes a versioned, endian-stable blob of Z80E_SNAPSHOT_SIZE bytes
+ * covering the register file, interrupt state, halt, the internal state and
+ * the T-state counter. The host wiring (callbacks, flat memory, scheduled
+ * event, predecode cache) is not part of the blob; memory contents must be
+ * snapshotted separately.
+ *
+ * @returns the number of bytes written
+ */
+zu32 z80e_save(z80e* z80, zu8* buf);
+
+/* Restore the architectural state saved by z80e_save
+ *
+ * The instance keeps its configuration (callbacks, flat memory); only the
+ * CPU state is replaced, so a blob saved from one instance can pre-warm any
+ * number of others regardless of build or host byte order. Clears a latched
+ * error and drops the predecode cache.
+ *
+ * @returns 0 on success, -1 if `buf` is not a valid snapshot
+ */
+int z80e_restore(z80e* z80, zu8 const* buf);
+
+/* Map a ROM image over `[base, base + size)`
+
+ * Reads and instruction fetches inside the range are bounds-checked pointer
+ * loads from `data` and writes into it are silently dropped, bypassing the
+ * callbacks (and the flat memory) entirely. Since the range cannot change,
+ * it never causes predecode cache invalidation either. The core does not
+ * copy `data`; it must stay valid while mapped. A range reaching past the
+ * 64 KB address space is clamped. One ROM can be mapped at a time; calling
+ * again replaces the mapping and passing a zero `size` or NULL `data`
+ * unmaps.
+ */
+void z80e_map_rom(z80e* z80, zu16 base, zu32 size, zu8 const* data);
+
+/* Map `count` consecutive 256-byte pages starting at page `first`
+ *
+ * `data` spans `count` * Z80E_PAGE_SIZE bytes and is accessed directly -
+ * callback-level flexibility at flat-memory speed. Banked machines keep one
+ * page table entry per 256-byte page and switch a 16 KB bank with a single
+ * call instead of dispatching a range switch inside `memread` on every
+ * access. Pages carrying Z80E_PAGE_RO drop writes, which subsumes
+ * z80e_map_rom; pages left unmapped (or unmapped again by passing NULL
+ * `data`) keep going through the callbacks, so observed regions can stay
+ * observed. A range reaching past the last page is clamped. The core does
+ * not copy `data`; it must stay valid while mapped.
+ */
+void z80e_map_page(z80e* z80, zu8 first, zu32 count, zu8* data, zu8 flags);
+
+/* Watch writes into `[base, base + len)`
+
+ * `fn` is invoked for every store whose address has its bit set in the
+ * watch bitmask, before the store lands, with the address and the byte
+ * being written. Unwatched stores pay one load-and-test, so a device
+ * mailbox can be observed without routing the whole address space through
+ * the memwrite callback - including in flat memory and paged modes, where
+ * memwrite is never called. Repeated calls accumulate ranges; all ranges
+ * share the last `fn` and `ctx`. Passing a NULL `fn` clears every watch. A
+ * range reaching past the 64 KB address space is clamped.
+ */
+void z80e_watch(z80e* z80, zu16 base, zu32 len, z80e_watch_fn_t fn, void* ctx);
+
+/* Emit an incremental checkpoint through `writer`
+
+ * Streams a small header, the z80e_save register blob and every 256-byte
+ * page written since the previous checkpoint (read back through the normal
+ * read path, so it works in callback, flat and paged modes), then clears
+ * the dirty bitmap. z80e_init marks all pages dirty, so the first
+ * checkpoint of an instance is a full 64 KB image - including read-only
+ * pages - and later ones are deltas, typically a few KB. Dropped writes to
+ * read-only pages never mark a page dirty, so the deltas exclude ROM.
+ * `writer` may be called once per page; buffer in the host if the sink
+ * prefers large writes.
+ *
+ * @returns the number of bytes emitted
+ */
+zu32 z80e_checkpoint(z80e* z80, z80e_writer_fn_t writer, void* ctx);
+
+/* Apply a checkpoint emitted by z80e_checkpoint
+
+ * Restores the register blob and stores the contained pages back, skipping
+ * the watchpoint hooks; apply checkpoints in emission order, starting from
+ * the full one. Applied pages are marked dirty. The stores honor the page
+ * flags, so the read-only pages contained in a full checkpoint leave ROM
+ * contents untouched.
+ *
+ * @returns 0 on success, -1 if `data` is not a valid checkpoint
+ */
+int z80e_checkpoint_apply(z80e* z80, zu8 const* data, zu32 len);
+
+/* Drop all predecode cache entries
+ *
+ * Call after modifying memory without going through the core (e.g. loading
+ * a program) while the predecode cache is enabled.
+ */
+void z80e_predecode_flush(z80e* z80);
+
+#ifdef Z80E_PROFILE
+/* Zero the profile counters without resetting the CPU */
+void z80e_profile_reset(z80e* z80);
+#endif
+
+#ifdef Z80E_TRACE
+/* Start tracing into a caller-provided ring of `size` records
+ *
+ * `size` must be a power of two; a ring of a million records captures the
+ * last million instructions when a fault fires. Passing a NULL `buf`
+ * stops tracing. Survives z80e_restore but not z80e_init.
+ */
+void z80e_trace_enable(z80e* z80, z80e_trace_record* buf, zu32 size);
+
+/* Copy up to `max` of the most recent trace records into `out`
+ *
+ * Records are written oldest first, so `out` reads chronologically.
+ *
+ * @returns the number of records copied; 0 while tracing is disabled
+ */
+zu32 z80e_trace_dump(z80e* z80, z80e_trace_record* out, zu32 max);
+#endif
 
 void z80e_halt(z80e* z80);
 int z80e_get_halt(z80e* z80);
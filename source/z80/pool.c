@@ -0,0 +1,81 @@
+/* Hosted companion to the freestanding core: needs pthreads, so it is not
+ * part of the WebAssembly build. */
+
+#include <pthread.h>
+
+#include "pool.h"
+
+#define POOL_MAX_THREADS 64
+
+typedef struct {
+  z80e_pool* pool;
+  zu32 tstates;
+  zu32 next; /*< Shared cursor; workers claim instances through it */
+  pthread_mutex_t lock;
+} pool_run_ctx;
+
+void z80e_pool_init(z80e_pool* pool, z80e* instances, zu8* mem, zu32 count, z80e_config* config) {
+  pool->instances = instances;
+  pool->mem = mem;
+  pool->count = count;
+
+  for (zu32 i = 0; i < count; ++i) {
+    z80e_config cfg = *config;
+    cfg.mem = mem ? mem + (zu32)0x10000 * i : 0;
+    z80e_init(&instances[i], &cfg);
+  }
+}
+
+static void* pool_worker(void* arg) {
+  pool_run_ctx* ctx = arg;
+
+  for (;;) {
+    pthread_mutex_lock(&ctx->lock);
+    zu32 i = ctx->next++;
+    pthread_mutex_unlock(&ctx->lock);
+    if (i >= ctx->pool->count) {
+      return 0;
+    }
+    z80e_run(&ctx->pool->instances[i], ctx->tstates);
+  }
+}
+
+void z80e_pool_run(z80e_pool* pool, zu32 tstates, zu32 nthreads) {
+  if (nthreads > pool->count) {
+    nthreads = pool->count;
+  }
+
+  if (nthreads <= 1) {
+    for (zu32 i = 0; i < pool->count; ++i) {
+      z80e_run(&pool->instances[i], tstates);
+    }
+    return;
+  }
+
+  if (nthreads > POOL_MAX_THREADS) {
+    nthreads = POOL_MAX_THREADS;
+  }
+
+  pool_run_ctx ctx = {
+      .pool = pool,
+      .tstates = tstates,
+      .next = 0,
+      .lock = PTHREAD_MUTEX_INITIALIZER,
+  };
+
+  /* The calling thread is worker zero */
+  pthread_t workers[POOL_MAX_THREADS - 1];
+  zu32 started = 0;
+  for (zu32 i = 0; i < nthreads - 1; ++i) {
+    if (pthread_create(&workers[i], 0, pool_worker, &ctx) != 0) {
+      break;
+    }
+    ++started;
+  }
+
+  pool_worker(&ctx);
+
+  for (zu32 i = 0; i < started; ++i) {
+    pthread_join(workers[i], 0);
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef Z80E_POOL_H
+#define Z80E_POOL_H
+
+#include "emulator.h"
+
+/* Instance pool
+ *
+ * Runs a fleet of independent emulator instances over contiguous,
+ * host-provided storage: the `instances` array keeps the CPU structs
+ * adjacent and `mem` packs the 64 KB flat-memory blocks back to back, so a
+ * fleet walks memory linearly instead of chasing heap-scattered
+ * allocations. The pool never allocates; the host owns both arrays.
+ */
+typedef struct {
+  z80e* instances; /*< Contiguous array of `count` instances */
+  zu8* mem;        /*< `count` adjacent 64 KB blocks; NULL for callback mode */
+  zu32 count;
+} z80e_pool;
+
+/* Initialize every instance in the pool
+ *
+ * `config` is a template: each instance gets its callbacks and ctx from it,
+ * and when `mem` is non-NULL its own 64 KB slice as flat memory (the
+ * template's own `mem` field is ignored). In callback mode the shared ctx
+ * must dispatch on the instance if per-instance state is needed.
+ */
+void z80e_pool_init(z80e_pool* pool, z80e* instances, zu8* mem, zu32 count, z80e_config* config);
+
+/* Advance every instance by at least `tstates` T-states
+ *
+ * With `nthreads` > 1 the instances are distributed over that many worker
+ * threads through a shared cursor, so threads that finish early pick up the
+ * remaining instances and an uneven fleet still balances. Instances are
+ * fully independent, which makes this safe without any per-instance
+ * locking; errors are latched per instance in `z80e.error` as usual.
+ */
+void z80e_pool_run(z80e_pool* pool, zu32 tstates, zu32 nthreads);
+
+#endif
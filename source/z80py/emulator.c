@@ -1,5 +1,7 @@
 #include <Python.h>
 
+#include <stddef.h>
+
 #include <object.h>
 #include <pyerrors.h>
 #include <z80/emulator.h>
@@ -9,6 +11,8 @@ typedef struct {
   PyObject* memwrite;
   PyObject* ioread;
   PyObject* iowrite;
+  Py_buffer membuf; /* Borrowed 64 KB flat memory; membuf.buf is NULL when callbacks are used */
+  PyObject* regview; /* Cached register view handed out by dump(); borrowed, cleared by its dealloc */
   z80e _z80;
   z80e_config config;
 
@@ -18,12 +22,23 @@ typedef struct {
   PyObject* exc_tb;
 } Z80;
 
+/* Register file view
+ *
+ * Reads attribute values straight out of the owner's z80e struct, so a
+ * register access costs one attribute lookup and one PyLong instead of the
+ * full dict of PyLongs the old dump() built on every call. dump() hands out
+ * one cached instance per Z80. */
+typedef struct {
+  PyObject_HEAD Z80* owner; /*< Strong reference; keeps the register file alive */
+} Registers;
+
 static int z80_module_exec(PyObject* m);
 
 static int Z80_init(Z80* self, PyObject* args, PyObject* kwargs);
 static void Z80_dealloc(Z80* self);
 
 static PyObject* Z80_instruction(PyObject* self, PyObject* args, PyObject* kwargs);
+static PyObject* Z80_run(PyObject* self, PyObject* args, PyObject* kwargs);
 static PyObject* Z80_dump(PyObject* self, void* closure);
 static PyObject* Z80_set_register(PyObject* self, PyObject* args, PyObject* kwargs);
 static PyObject* Z80_get_register(PyObject* self, PyObject* args, PyObject* kwargs);
@@ -36,8 +51,72 @@ static void memwrite_fn(zu32 addr, zu8 byte, void* ctx);
 static zu8 ioread_fn(zu16 addr, zu8 byte, void* ctx);
 static void iowrite_fn(zu16 addr, zu8 byte, void* ctx);
 
+static void Registers_dealloc(Registers* self);
+
+static PyObject* Registers_get8(PyObject* self, void* closure) {
+  Registers* _self = (Registers*)self;
+  return PyLong_FromLong(*(zu8*)((char*)&_self->owner->_z80 + (size_t)closure));
+}
+
+static PyObject* Registers_get16(PyObject* self, void* closure) {
+  Registers* _self = (Registers*)self;
+  return PyLong_FromLong(*(zu16*)((char*)&_self->owner->_z80 + (size_t)closure));
+}
+
+/* clang-format off */
+#define reg8(name, field) {name, Registers_get8, NULL, NULL, (void*)offsetof(z80e, field)}
+#define reg16(name, field) {name, Registers_get16, NULL, NULL, (void*)offsetof(z80e, field)}
+
+static PyGetSetDef Registers_getsetters[] = {
+    reg8("a", reg.main.a),      reg8("b", reg.main.b),      reg8("c", reg.main.c),      reg8("d", reg.main.d),
+    reg8("e", reg.main.e),      reg8("f", reg.main.f),      reg8("h", reg.main.h),      reg8("l", reg.main.l),
+    reg16("af", reg.main.af),   reg16("bc", reg.main.bc),   reg16("de", reg.main.de),   reg16("hl", reg.main.hl),
+    reg8("a_alt", reg.alt.a),   reg8("b_alt", reg.alt.b),   reg8("c_alt", reg.alt.c),   reg8("d_alt", reg.alt.d),
+    reg8("e_alt", reg.alt.e),   reg8("f_alt", reg.alt.f),   reg8("h_alt", reg.alt.h),   reg8("l_alt", reg.alt.l),
+    reg16("af_alt", reg.alt.af), reg16("bc_alt", reg.alt.bc), reg16("de_alt", reg.alt.de), reg16("hl_alt", reg.alt.hl),
+    reg8("i", reg.i),           reg8("r", reg.r),           reg16("ix", reg.ix),        reg16("iy", reg.iy),
+    reg16("sp", reg.sp),        reg16("pc", reg.pc),        reg8("u", reg.u),
+    {NULL},
+};
+/* clang-format on */
+
+/* Subscript falls back to attribute lookup so registers["a"] keeps working
+ * for code written against the old dict */
+static PyObject* Registers_subscript(PyObject* self, PyObject* key) {
+  PyObject* value = PyObject_GetAttr(self, key);
+  if (value == NULL && PyErr_ExceptionMatches(PyExc_AttributeError)) {
+    PyErr_Clear();
+    PyErr_Format(PyExc_KeyError, "no such register: %U", key);
+  }
+  return value;
+}
+
+static PyMappingMethods Registers_mapping = {
+    .mp_subscript = Registers_subscript,
+};
+
+static PyTypeObject RegistersType = {
+    .ob_base = PyVarObject_HEAD_INIT(NULL, 0).tp_name = "z80py.Registers",
+    .tp_doc = PyDoc_STR("Z80 register file view"),
+    .tp_basicsize = sizeof(Registers),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .tp_dealloc = (destructor)Registers_dealloc,
+    .tp_getset = Registers_getsetters,
+    .tp_as_mapping = &Registers_mapping,
+};
+
+static void Registers_dealloc(Registers* self) {
+  if (self->owner->regview == (PyObject*)self) {
+    self->owner->regview = NULL;
+  }
+  Py_DECREF(self->owner);
+  Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
 static PyMethodDef Z80_methods[] = {
     {"instruction", (PyCFunction)Z80_instruction, METH_NOARGS, "Execute one instruction"},
+    {"run", (PyCFunction)Z80_run, METH_VARARGS, "Execute instructions for at least the given number of T-states"},
     {"dump", (PyCFunction)Z80_dump, METH_NOARGS, "Get a register dump"},
     {"set_register", (PyCFunction)Z80_set_register, METH_VARARGS, "Set a register value"},
     {"get_register", (PyCFunction)Z80_get_register, METH_VARARGS, "Get a register value"},
@@ -90,24 +169,59 @@ PyMODINIT_FUNC PyInit_z80py(void) { return PyModuleDef_Init(&z80_module); }
   Py_XSETREF(self->argname, Py_NewRef(argname));
 
 static int Z80_init(Z80* self, PyObject* args, PyObject* kwargs) {
-  static char* kwlist[] = {"memread", "memwrite", "ioread", "iowrite", NULL};
-  PyObject *memread, *memwrite, *ioread, *iowrite;
+  static char* kwlist[] = {"memread", "memwrite", "ioread", "iowrite", "memory", NULL};
+  PyObject *memread = NULL, *memwrite = NULL, *ioread = NULL, *iowrite = NULL, *memory = NULL;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOOO", kwlist, &memread, &memwrite, &ioread, &iowrite)) {
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OOOOO", kwlist, &memread, &memwrite, &ioread, &iowrite, &memory)) {
     return -1;
   }
 
-  set_arg(memread);
-  set_arg(memwrite);
+  if (ioread == NULL || iowrite == NULL) {
+    PyErr_SetString(PyExc_TypeError, "ioread and iowrite are required");
+    return -1;
+  }
+
+  if (memory != NULL) {
+    /* Zero-copy flat memory: the core reads and writes the buffer directly,
+     * no memread/memwrite round-trips through the interpreter */
+    if (memread != NULL || memwrite != NULL) {
+      PyErr_SetString(PyExc_TypeError, "memory cannot be combined with memread/memwrite");
+      return -1;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(memory, &view, PyBUF_WRITABLE | PyBUF_SIMPLE) < 0) {
+      return -1;
+    }
+    if (view.len != 0x10000) {
+      PyBuffer_Release(&view);
+      PyErr_Format(PyExc_ValueError, "memory must be a writable 64 KB buffer, got %zd bytes", view.len);
+      return -1;
+    }
+    if (self->membuf.buf != NULL) {
+      PyBuffer_Release(&self->membuf);
+    }
+    self->membuf = view;
+  } else {
+    if (memread == NULL || memwrite == NULL) {
+      PyErr_SetString(PyExc_TypeError, "either memory or memread and memwrite are required");
+      return -1;
+    }
+
+    set_arg(memread);
+    set_arg(memwrite);
+  }
+
   set_arg(ioread);
   set_arg(iowrite);
 
   z80e_config cfg = {
       .ctx = self,
-      .memread = memread_fn,
-      .memwrite = memwrite_fn,
+      .memread = memory == NULL ? memread_fn : NULL,
+      .memwrite = memory == NULL ? memwrite_fn : NULL,
       .ioread = ioread_fn,
       .iowrite = iowrite_fn,
+      .mem = memory == NULL ? NULL : self->membuf.buf,
   };
   self->config = cfg;
   z80e_init(&self->_z80, &self->config);
@@ -120,6 +234,9 @@ static void Z80_dealloc(Z80* self) {
   Py_XDECREF(self->memwrite);
   Py_XDECREF(self->ioread);
   Py_XDECREF(self->iowrite);
+  if (self->membuf.buf != NULL) {
+    PyBuffer_Release(&self->membuf);
+  }
   Py_TYPE(self)->tp_free((PyObject*)self);
 }
 
@@ -136,11 +253,15 @@ static PyObject* Z80_instruction(PyObject* self, PyObject* args, PyObject* kwarg
   if (!_self)
     return NULL;
 
-  zi8 t_states = z80e_instruction(&_self->_z80);
+  zi32 t_states = z80e_instruction(&_self->_z80);
 
   if (_self->exc_occurred) {
     _self->exc_occurred = 0;
+    if (_self->_z80.error == Z80E_HOST_ABORT) {
+      _self->_z80.error = Z80E_OK;
+    }
     PyErr_Restore(_self->exc_type, _self->exc_value, _self->exc_tb);
+    _self->exc_type = _self->exc_value = _self->exc_tb = NULL;
     return NULL;
   }
 
@@ -157,6 +278,45 @@ static PyObject* Z80_instruction(PyObject* self, PyObject* args, PyObject* kwarg
   return ret;
 }
 
+static PyObject* Z80_run(PyObject* self, PyObject* args, PyObject* kwargs) {
+  Z80* _self = self_type(self);
+  if (!_self)
+    return NULL;
+
+  unsigned int tstates;
+  if (!PyArg_ParseTuple(args, "I", &tstates))
+    return NULL;
+
+  zu32 consumed;
+  /* The core loop itself never touches the interpreter; the callbacks
+   * re-acquire the GIL on entry, so only the dispatch overhead runs
+   * unlocked in callback mode while flat-memory runs are fully parallel */
+  Py_BEGIN_ALLOW_THREADS;
+  consumed = z80e_run(&_self->_z80, tstates);
+  Py_END_ALLOW_THREADS;
+
+  if (_self->exc_occurred) {
+    _self->exc_occurred = 0;
+    if (_self->_z80.error == Z80E_HOST_ABORT) {
+      _self->_z80.error = Z80E_OK;
+    }
+    PyErr_Restore(_self->exc_type, _self->exc_value, _self->exc_tb);
+    _self->exc_type = _self->exc_value = _self->exc_tb = NULL;
+    return NULL;
+  }
+
+  if (_self->_z80.error == Z80E_DAA_INVALID_VALUE) {
+    PyErr_Format(exc_InvalidDAAValueError, "invalid DAA value at 0x%04x", _self->_z80.reg.pc);
+    return NULL;
+  }
+  if (_self->_z80.error == Z80E_INVALID_OPCODE) {
+    PyErr_Format(exc_InvalidOpcodeError, "invalid opcode at 0x%04x", _self->_z80.reg.pc);
+    return NULL;
+  }
+
+  return PyLong_FromUnsignedLong(consumed);
+}
+
 static PyObject* Z80_get_halted(PyObject* self, void* closure) {
   Z80* _self = self_type(self);
   if (!_self)
@@ -165,64 +325,21 @@ static PyObject* Z80_get_halted(PyObject* self, void* closure) {
   return PyBool_FromLong(result);
 }
 
-#define set_main_reg(name)                                                                                             \
-  tmp = Py_BuildValue("i", _self->_z80.reg.main.name);                                                                 \
-  if (!tmp) {                                                                                                          \
-    return NULL;                                                                                                       \
-  }                                                                                                                    \
-  PyDict_SetItemString(dct, #name, tmp);
-
-#define set_alt_reg(name)                                                                                              \
-  tmp = Py_BuildValue("i", _self->_z80.reg.alt.name);                                                                  \
-  if (!tmp) {                                                                                                          \
-    return NULL;                                                                                                       \
-  }                                                                                                                    \
-  PyDict_SetItemString(dct, #name "_alt", tmp);
-
-#define set_reg(name)                                                                                                  \
-  tmp = Py_BuildValue("i", _self->_z80.reg.name);                                                                      \
-  if (!tmp) {                                                                                                          \
-    return NULL;                                                                                                       \
-  }                                                                                                                    \
-  PyDict_SetItemString(dct, #name, tmp);
-
 static PyObject* Z80_dump(PyObject* self, void* closure) {
   Z80* _self = self_type(self);
   if (!_self)
     return NULL;
 
-  PyObject* tmp;
-
-  PyObject* dct = PyDict_New();
-  if (!dct) {
-    return NULL;
+  if (_self->regview == NULL) {
+    Registers* view = PyObject_New(Registers, &RegistersType);
+    if (!view) {
+      return NULL;
+    }
+    view->owner = (Z80*)Py_NewRef(self);
+    _self->regview = (PyObject*)view;
   }
 
-  set_main_reg(a);
-  set_main_reg(b);
-  set_main_reg(c);
-  set_main_reg(d);
-  set_main_reg(e);
-  set_main_reg(h);
-  set_main_reg(l);
-  set_main_reg(f);
-  set_alt_reg(a);
-  set_alt_reg(b);
-  set_alt_reg(c);
-  set_alt_reg(d);
-  set_alt_reg(e);
-  set_alt_reg(h);
-  set_alt_reg(l);
-  set_alt_reg(f);
-  set_reg(i);
-  set_reg(r);
-  set_reg(ix);
-  set_reg(iy);
-  set_reg(sp);
-  set_reg(pc);
-  set_reg(u);
-
-  return dct;
+  return Py_NewRef(_self->regview);
 }
 
 static PyObject* Z80_set_register(PyObject* self, PyObject* args, PyObject* kwargs) {
@@ -341,91 +458,113 @@ static PyObject* Z80_reset(PyObject* self, PyObject* args, PyObject* kwargs) {
   return Py_None;
 }
 
+/* The callbacks are invoked from the core, which Z80_run enters with the GIL
+ * released, so each one re-acquires it for the duration of the Python call.
+ * PyGILState_Ensure is recursion-safe and cheap when the GIL is already held
+ * (the Z80_instruction path). */
+
+/* Stash the pending exception and stop the core. Only the first exception
+ * is kept - a later one would overwrite and leak the stashed references -
+ * and Z80E_HOST_ABORT makes z80e_run bail out at the end of the current
+ * instruction instead of burning the rest of the T-state budget on NOPs.
+ * Must be called with the GIL held and an exception set. */
+static void stash_exception(Z80* self) {
+  if (self->exc_occurred) {
+    PyErr_Clear();
+    return;
+  }
+  self->exc_occurred = 1;
+  PyErr_Fetch(&self->exc_type, &self->exc_value, &self->exc_tb);
+  self->_z80.error = Z80E_HOST_ABORT;
+}
+
 static zu8 memread_fn(zu32 addr, void* ctx) {
   Z80* self = ctx;
+  PyGILState_STATE gstate = PyGILState_Ensure();
   PyObject *result, *args = Py_BuildValue("(i)", addr);
   int ret = 0;
 
   if ((result = PyObject_CallObject(self->memread, args)) == NULL) {
     printf("memread_fn: exception\n");
-    self->exc_occurred = 1;
-    PyErr_Fetch(&self->exc_type, &self->exc_value, &self->exc_tb);
+    stash_exception(self);
     goto cleanup;
   }
 
   ret = PyLong_AsLong(result);
   if (ret == -1 && PyErr_Occurred()) {
     printf("memread_fn: exception\n");
-    self->exc_occurred = 1;
-    PyErr_Fetch(&self->exc_type, &self->exc_value, &self->exc_tb);
+    stash_exception(self);
     goto cleanup;
   }
 
 cleanup:
   Py_DECREF(args);
+  PyGILState_Release(gstate);
 
   return ret;
 }
 
 static void memwrite_fn(zu32 addr, zu8 byte, void* ctx) {
   Z80* self = ctx;
+  PyGILState_STATE gstate = PyGILState_Ensure();
   PyObject* args = Py_BuildValue("(ii)", addr, byte);
   if (PyObject_CallObject(self->memwrite, args) == NULL) {
-    self->exc_occurred = 1;
-    PyErr_Fetch(&self->exc_type, &self->exc_value, &self->exc_tb);
+    stash_exception(self);
   }
   Py_DECREF(args);
+  PyGILState_Release(gstate);
 }
 
 static zu8 ioread_fn(zu16 addr, zu8 byte, void* ctx) {
   Z80* self = ctx;
+  PyGILState_STATE gstate = PyGILState_Ensure();
   PyObject *result = NULL, *args = Py_BuildValue("(ii)", addr, byte);
   int ret = 0;
 
   if (args == NULL) {
-    self->exc_occurred = 1;
-    PyErr_Fetch(&self->exc_type, &self->exc_value, &self->exc_tb);
+    stash_exception(self);
+    PyGILState_Release(gstate);
     return ret;
   }
 
   if ((result = PyObject_CallObject(self->ioread, args)) == NULL) {
-    self->exc_occurred = 1;
-    PyErr_Fetch(&self->exc_type, &self->exc_value, &self->exc_tb);
+    stash_exception(self);
     goto cleanup;
   }
 
   ret = PyLong_AsLong(result);
   if (ret == -1 && PyErr_Occurred()) {
-    self->exc_occurred = 1;
-    PyErr_Fetch(&self->exc_type, &self->exc_value, &self->exc_tb);
+    stash_exception(self);
     goto cleanup;
   }
 
 cleanup:
   Py_DECREF(args);
   Py_XDECREF(result);
+  PyGILState_Release(gstate);
 
   return ret;
 }
 
 static void iowrite_fn(zu16 addr, zu8 byte, void* ctx) {
   Z80* self = ctx;
+  PyGILState_STATE gstate = PyGILState_Ensure();
 
   PyObject* args = Py_BuildValue("(ii)", addr, byte);
   if (args == NULL) {
-    self->exc_occurred = 1;
-    PyErr_Fetch(&self->exc_type, &self->exc_value, &self->exc_tb);
+    stash_exception(self);
+    PyGILState_Release(gstate);
     return;
   }
 
   PyObject* result = NULL;
   if ((result = PyObject_CallObject(self->iowrite, args)) == NULL) {
-    self->exc_occurred = 1;
-    PyErr_Fetch(&self->exc_type, &self->exc_value, &self->exc_tb);
+    stash_exception(self);
   }
 
   Py_DECREF(args);
   Py_XDECREF(result);
+  PyGILState_Release(gstate);
 }
 
 static int z80_module_exec(PyObject* m) {
@@ -437,6 +576,14 @@ static int z80_module_exec(PyObject* m) {
     return -1;
   }
 
+  if (PyType_Ready(&RegistersType) < 0) {
+    return -1;
+  }
+
+  if (PyModule_AddObjectRef(m, "Registers", (PyObject*)&RegistersType) < 0) {
+    return -1;
+  }
+
   exc_InvalidDAAValueError = PyErr_NewException("z80py.InvalidDAAValueError", PyExc_Exception, NULL);
   if (exc_InvalidDAAValueError == NULL) {
     Py_DECREF(m);
@@ -1,21 +1,64 @@
 from typing import Callable
 
+from collections.abc import Buffer
+
+
+class Registers:
+    a: int
+    b: int
+    c: int
+    d: int
+    e: int
+    f: int
+    h: int
+    l: int
+    af: int
+    bc: int
+    de: int
+    hl: int
+    a_alt: int
+    b_alt: int
+    c_alt: int
+    d_alt: int
+    e_alt: int
+    f_alt: int
+    h_alt: int
+    l_alt: int
+    af_alt: int
+    bc_alt: int
+    de_alt: int
+    hl_alt: int
+    i: int
+    r: int
+    ix: int
+    iy: int
+    sp: int
+    pc: int
+    u: int
+
+    def __getitem__(self, register: str) -> int:
+        ...
+
 
 class Z80:
 
     def __init__(
         self,
-        memread: Callable[[int], int],
-        memwrite: Callable[[int, int], None],
-        ioread: Callable[[int, int], int],
-        iowrite: Callable[[int, int], None]
+        memread: Callable[[int], int] | None = None,
+        memwrite: Callable[[int, int], None] | None = None,
+        ioread: Callable[[int, int], int] = ...,
+        iowrite: Callable[[int, int], None] = ...,
+        memory: Buffer | None = None
     ) -> None:
         ...
 
     def instruction(self) -> int:
         ...
 
-    def dump(self) -> dict[str, int]:
+    def run(self, tstates: int) -> int:
+        ...
+
+    def dump(self) -> Registers:
         ...
 
     def set_register(self, register: str, value: int) -> None:
@@ -19,6 +19,7 @@ extern unsigned char __heap_base;
 static z80e_config _config;
 static z80e _emu;
 static status_type _status;
+static zu8 _ram[0x10000];
 static unsigned int _bump_ptr = (unsigned int)&__heap_base;
 
 static zu32 hash(char const* s);
@@ -29,15 +30,23 @@ void init(void) {
   _config.ioread = ioread_fn;
   _config.iowrite = iowrite_fn;
   _config.ctx = (void*)0;
+  _config.mem = (zu8*)0;
 
   z80e_init(&_emu, &_config);
 }
 
+void init_flat(void) {
+  init();
+  _config.mem = _ram;
+  z80e_init(&_emu, &_config);
+}
+
 void reset(void) { z80e_init(&_emu, &_config); }
 
-zi8 execute_instruction(void) {
-  zi8 ret = z80e_instruction(&_emu);
-  switch (ret) {
+zu8* get_memory(void) { return _ram; }
+
+static void set_error_status(zi32 error) {
+  switch (error) {
   case Z80E_DAA_INVALID_VALUE:
     _status = STATUS_ERROR_DAA_INVALID_VALUE;
     break;
@@ -45,15 +54,47 @@ zi8 execute_instruction(void) {
     _status = STATUS_ERROR_INVALID_OPCODE;
     break;
   }
+}
+
+zi32 execute_instruction(void) {
+  zi32 ret = z80e_instruction(&_emu);
+  set_error_status(ret);
   return ret;
 }
 
+zu32 run(zu32 tstates) {
+  zu32 consumed = z80e_run(&_emu, tstates);
+  set_error_status(_emu.error);
+  return consumed;
+}
+
+#define ARENA_ALIGN 8
+
 void* allocate(int n) {
-  unsigned int ptr = _bump_ptr;
-  _bump_ptr += n;
+  unsigned int ptr = (_bump_ptr + (ARENA_ALIGN - 1)) & ~(unsigned int)(ARENA_ALIGN - 1);
+  /* A negative size would move the bump pointer backwards over live
+   * allocations, and an oversized one would wrap it past the arena */
+  if (n <= 0 || (unsigned int)n > 0xffffffffu - ptr) {
+    return (void*)0;
+  }
+  _bump_ptr = ptr + n;
   return (void*)ptr;
 }
 
+zu32 arena_mark(void) { return _bump_ptr; }
+
+void arena_reset(zu32 mark) {
+  if (mark == 0) {
+    _bump_ptr = (unsigned int)&__heap_base;
+    return;
+  }
+  if (mark < (unsigned int)&__heap_base || mark > _bump_ptr) {
+    _status = STATUS_ERROR_BAD_ARENA_MARK;
+    return;
+  }
+  _bump_ptr = mark;
+}
+
 status_type get_status(void) {
   status_type tmp = _status;
   _status = STATUS_OK;
@@ -171,6 +212,91 @@ void set_register16(char const* r, zu16 v) {
   }
 }
 
+zu16 get_reg(int id) {
+  switch (id) {
+  case REG_A: return _emu.reg.main.a;
+  case REG_B: return _emu.reg.main.b;
+  case REG_C: return _emu.reg.main.c;
+  case REG_D: return _emu.reg.main.d;
+  case REG_E: return _emu.reg.main.e;
+  case REG_H: return _emu.reg.main.h;
+  case REG_L: return _emu.reg.main.l;
+  case REG_F: return _emu.reg.main.f;
+  case REG_A_ALT: return _emu.reg.alt.a;
+  case REG_B_ALT: return _emu.reg.alt.b;
+  case REG_C_ALT: return _emu.reg.alt.c;
+  case REG_D_ALT: return _emu.reg.alt.d;
+  case REG_E_ALT: return _emu.reg.alt.e;
+  case REG_H_ALT: return _emu.reg.alt.h;
+  case REG_L_ALT: return _emu.reg.alt.l;
+  case REG_F_ALT: return _emu.reg.alt.f;
+  case REG_I: return _emu.reg.i;
+  case REG_R: return _emu.reg.r;
+  case REG_IX: return _emu.reg.ix;
+  case REG_IY: return _emu.reg.iy;
+  case REG_SP: return _emu.reg.sp;
+  case REG_PC: return _emu.reg.pc;
+  case REG_U: return _emu.reg.u;
+  case REG_AF: return _emu.reg.main.af;
+  case REG_BC: return _emu.reg.main.bc;
+  case REG_DE: return _emu.reg.main.de;
+  case REG_HL: return _emu.reg.main.hl;
+  case REG_AF_ALT: return _emu.reg.alt.af;
+  case REG_BC_ALT: return _emu.reg.alt.bc;
+  case REG_DE_ALT: return _emu.reg.alt.de;
+  case REG_HL_ALT: return _emu.reg.alt.hl;
+  default:
+    _status = STATUS_ERROR_NO_REGISTER;
+    return 0;
+  }
+}
+
+void set_reg(int id, zu16 v) {
+  switch (id) {
+  case REG_A: _emu.reg.main.a = v; break;
+  case REG_B: _emu.reg.main.b = v; break;
+  case REG_C: _emu.reg.main.c = v; break;
+  case REG_D: _emu.reg.main.d = v; break;
+  case REG_E: _emu.reg.main.e = v; break;
+  case REG_H: _emu.reg.main.h = v; break;
+  case REG_L: _emu.reg.main.l = v; break;
+  case REG_F: _emu.reg.main.f = v; break;
+  case REG_A_ALT: _emu.reg.alt.a = v; break;
+  case REG_B_ALT: _emu.reg.alt.b = v; break;
+  case REG_C_ALT: _emu.reg.alt.c = v; break;
+  case REG_D_ALT: _emu.reg.alt.d = v; break;
+  case REG_E_ALT: _emu.reg.alt.e = v; break;
+  case REG_H_ALT: _emu.reg.alt.h = v; break;
+  case REG_L_ALT: _emu.reg.alt.l = v; break;
+  case REG_F_ALT: _emu.reg.alt.f = v; break;
+  case REG_I: _emu.reg.i = v; break;
+  case REG_R: _emu.reg.r = v; break;
+  case REG_IX: _emu.reg.ix = v; break;
+  case REG_IY: _emu.reg.iy = v; break;
+  case REG_SP: _emu.reg.sp = v; break;
+  case REG_PC: _emu.reg.pc = v; break;
+  case REG_U: _emu.reg.u = v; break;
+  case REG_AF: _emu.reg.main.af = v; break;
+  case REG_BC: _emu.reg.main.bc = v; break;
+  case REG_DE: _emu.reg.main.de = v; break;
+  case REG_HL: _emu.reg.main.hl = v; break;
+  case REG_AF_ALT: _emu.reg.alt.af = v; break;
+  case REG_BC_ALT: _emu.reg.alt.bc = v; break;
+  case REG_DE_ALT: _emu.reg.alt.de = v; break;
+  case REG_HL_ALT: _emu.reg.alt.hl = v; break;
+  default:
+    _status = STATUS_ERROR_NO_REGISTER;
+    break;
+  }
+}
+
+zu32 dump_registers(zu16* ptr) {
+  for (int id = 0; id < REG_ID_COUNT; ++id) {
+    ptr[id] = get_reg(id);
+  }
+  return REG_ID_COUNT;
+}
+
 int is_halted(void) {
   return _emu.halt;
 }
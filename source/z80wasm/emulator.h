@@ -3,29 +3,123 @@
 typedef enum {
   STATUS_OK = 0,
   STATUS_ERROR_NO_REGISTER = 1,
+  STATUS_ERROR_BAD_ARENA_MARK = 2,
   STATUS_ERROR_DAA_INVALID_VALUE = -1,
   STATUS_ERROR_INVALID_OPCODE = -2
 } status_type;
 
-/** Initialize WebAssembly module */
+/* Register indices for the hash-free access API; the order is also the
+ * layout dump_registers writes */
+typedef enum {
+  REG_A = 0,
+  REG_B,
+  REG_C,
+  REG_D,
+  REG_E,
+  REG_H,
+  REG_L,
+  REG_F,
+  REG_A_ALT,
+  REG_B_ALT,
+  REG_C_ALT,
+  REG_D_ALT,
+  REG_E_ALT,
+  REG_H_ALT,
+  REG_L_ALT,
+  REG_F_ALT,
+  REG_I,
+  REG_R,
+  REG_IX,
+  REG_IY,
+  REG_SP,
+  REG_PC,
+  REG_U,
+  REG_AF,
+  REG_BC,
+  REG_DE,
+  REG_HL,
+  REG_AF_ALT,
+  REG_BC_ALT,
+  REG_DE_ALT,
+  REG_HL_ALT,
+  REG_ID_COUNT
+} z80_reg_id;
+
+/** Initialize WebAssembly module
+ *
+ * Memory and IO accesses go through the imported env callbacks; every
+ * emulated byte access crosses the WASM/JS boundary.
+ */
 void init(void);
 
+/** Initialize WebAssembly module with RAM in linear memory
+ *
+ * The emulated 64 kB RAM lives inside the module and the core accesses it
+ * directly; only IO goes through the imported env callbacks. JS reads and
+ * writes the RAM through a Uint8Array view at the offset returned by
+ * get_memory.
+ */
+void init_flat(void);
+
 /** Reset the CPU */
 void reset(void);
 
+/** Get the linear-memory offset of the emulated RAM
+ *
+ * Construct a Uint8Array(module.memory.buffer, offset, 0x10000) view over
+ * it to load programs and inspect memory without boundary crossings. The
+ * RAM is used by the core only after init_flat.
+ *
+ * @returns Offset of the 64 kB RAM block
+ */
+zu8* get_memory(void);
+
 /** Execute one instruction and set module status */
-zi8 execute_instruction(void);
+zi32 execute_instruction(void);
+
+/** Execute instructions until at least `tstates` T-states have elapsed
+ *
+ * One call replaces thousands of execute_instruction round trips; combined
+ * with init_flat the whole batch runs without crossing the WASM/JS
+ * boundary. Stops early on error and sets module status.
+ *
+ * @param tstates T-state budget
+ * @returns Number of T-states actually consumed
+ */
+zu32 run(zu32 tstates);
 
 /** Allocate a buffer of size n
  *
- * Uses bump allocator under the hood and not intended to be used as a
- * replacement for `malloc`.
+ * Arena allocation: buffers are carved off a bump pointer, 8-byte aligned,
+ * and freed only in bulk by rewinding to a marker (see arena_mark and
+ * arena_reset). Not a `malloc` replacement. The emulated RAM is a static
+ * block reserved at compile time, so steady-state stepping allocates
+ * nothing and never grows linear memory; the arena is for transient host
+ * buffers like program images and strings.
  *
  * @param n Size of the buffer
  * @returns Pointer to the buffer
  */
 void* allocate(int n);
 
+/** Get a marker for the current arena position
+ *
+ * @returns Marker to pass to arena_reset
+ */
+zu32 arena_mark(void);
+
+/** Free every allocation made after a marker
+ *
+ * Rewinds the arena to `mark` as returned by arena_mark; pass 0 to free
+ * everything. A marker outside the arena sets STATUS_ERROR_BAD_ARENA_MARK
+ * and leaves the arena untouched. Long-lived sessions that repeatedly load
+ * programs should bracket each load with a mark/reset pair so linear
+ * memory stays flat.
+ *
+ * @param mark Marker, or 0 for a full reset
+ */
+void arena_reset(zu32 mark);
+
 /** Get the status of the module
  *
  * Returns the status and sets the current status to STATUS_OK.
@@ -63,6 +157,33 @@ zu16 get_register16(char const* r);
 void set_register16(char const* r, zu16 v);
 
 
+/** Get a register value by index
+ *
+ * Index-based alternative to get_register8/get_register16: no string
+ * marshalling across the boundary. 8-bit registers come back zero-extended.
+ *
+ * @param id Register index
+ */
+zu16 get_reg(int id);
+
+/** Set a register value by index
+ *
+ * @param id Register index
+ * @param v Value; truncated to the register width
+ */
+void set_reg(int id, zu16 v);
+
+/** Write every register to a caller-provided buffer
+ *
+ * Writes REG_ID_COUNT 16-bit values in z80_reg_id order to `ptr`, so a
+ * debugger panel snapshots the whole register file with one call and reads
+ * it through one Uint16Array view.
+ *
+ * @param ptr Buffer of at least REG_ID_COUNT 16-bit slots
+ * @returns Number of values written
+ */
+zu32 dump_registers(zu16* ptr);
+
 /** Get whether the CPU is halted
  *
  * @returns Halted
@@ -6,7 +6,7 @@ from typing import Optional, Callable
 
 from z80asm import Z80AsmParser, Z80AsmLayouter, Z80AsmCompiler, Z80AsmPrinter
 
-from z80py import Z80, InvalidDAAValueError, InvalidOpcodeError
+from z80py import Z80, Registers, InvalidDAAValueError, InvalidOpcodeError
 
 TESTS_DIR = Path(__file__).resolve().parent
 PROJECT_ROOT = TESTS_DIR.parent
@@ -19,6 +19,12 @@ TEST_TIMEOUT_SEC = 1
 
 MEMFILE_SIZE_BYTES = 2 ** 16
 
+REGISTER_NAMES = (
+    "a", "b", "c", "d", "e", "h", "l", "f",
+    "a_alt", "b_alt", "c_alt", "d_alt", "e_alt", "h_alt", "l_alt", "f_alt",
+    "i", "r", "ix", "iy", "sp", "pc", "u",
+)
+
 
 def compile_asm(source: str) -> tuple[str, bytes]:
     parser = Z80AsmParser(undoc_instructions=True)
@@ -87,7 +93,7 @@ class Tester:
                 assert addr < len(self.memory)
                 self.memory[addr] = byte
 
-    def run_test(self) -> dict[str, int]:
+    def run_test(self) -> Registers:
         memread, memwrite, ioread, iowrite = self._get_io_funcs()
 
         cpu = Z80(memread, memwrite, ioread, iowrite)
@@ -154,8 +160,9 @@ class Tester:
 
         return memread, memwrite, ioread, iowrite
 
-    def _assert_registers(self, registers: dict[str, int]):
-        for reg, val in registers.items():
+    def _assert_registers(self, registers: Registers):
+        for reg in REGISTER_NAMES:
+            val = getattr(registers, reg)
             clue = self.expected_registers.get(reg, 0)
             if val == clue:
                 continue
@@ -0,0 +1,130 @@
+"""Pack tests/instructions.yaml into a binary batch for the z80btest runner.
+
+All the per-case work that is slow in Python (assembling, YAML parsing) is
+done once here; the resulting file is a flat little-endian stream the C
+runner walks without any parsing beyond length-prefixed records.
+
+Format (version 1):
+
+    magic "Z80B", u8 version, u32 case count
+
+    per case:
+        u16 desc length, desc bytes
+        u16 program length, program bytes (loaded at address 0)
+        u8 preset register count, entries of {u8 register id, u16 value}
+        u16 preset memory count, entries of {u16 addr, u8 value}
+        u16 expected value for every register, in REGISTER_NAMES order
+        u16 memory checkpoint count, entries of {u16 addr, u8 value}
+        u8 read port count, entries of {u8 port, u16 length, bytes}
+        u8 write port count, entries of {u8 port, u16 length, bytes}
+
+Read sequences come from the YAML `io.in` mapping and serve port reads;
+write sequences come from `io.out` and are asserted against port writes,
+matching how test_instructions.py wires them into the Tester. Cases with
+`skip` are not packed. Registers absent from `regs` are expected to be 0,
+same as the Python harness.
+"""
+
+import struct
+import sys
+
+from io import StringIO, BytesIO
+from pathlib import Path
+
+import yaml
+
+from z80asm import Z80AsmParser, Z80AsmLayouter, Z80AsmCompiler
+
+TESTS_DIR = Path(__file__).resolve().parent
+INSTRUCTIONS = TESTS_DIR / "instructions.yaml"
+
+REGISTER_NAMES = (
+    "a", "b", "c", "d", "e", "h", "l", "f",
+    "a_alt", "b_alt", "c_alt", "d_alt", "e_alt", "h_alt", "l_alt", "f_alt",
+    "i", "r", "ix", "iy", "sp", "pc", "u",
+)
+
+
+def compile_asm(source: str) -> bytes:
+    parser = Z80AsmParser(undoc_instructions=True)
+    parser.parse_stream(StringIO(source))
+
+    layouter = Z80AsmLayouter()
+    layouter.layout_program(parser.instructions)
+
+    compiler = Z80AsmCompiler()
+    compiler.compile_program(parser.instructions)
+
+    ostream = BytesIO()
+    compiler.emit_bytes(ostream)
+    return ostream.getvalue()
+
+
+def pack_case(out: BytesIO, test: dict):
+    desc: str = test["desc"]
+    encoded = compile_asm(test["source"])
+    preset: dict = test.get("preset") or {}
+    preset_regs: dict = preset.get("regs") or {}
+    preset_mem: dict = preset.get("mem") or {}
+    io: dict = preset.get("io") or {}
+    read_seqs: dict = io.get("in") or {}
+    write_seqs: dict = io.get("out") or {}
+    expected_regs: dict = test.get("regs") or {}
+    checkpoints: dict = test.get("mem") or {}
+
+    desc_bytes = desc.encode()
+    out.write(struct.pack("<H", len(desc_bytes)))
+    out.write(desc_bytes)
+
+    assert len(encoded) < 0x10000, f"{desc}: program exceeds addressable memory"
+    out.write(struct.pack("<H", len(encoded)))
+    out.write(encoded)
+
+    out.write(struct.pack("<B", len(preset_regs)))
+    for reg, val in preset_regs.items():
+        out.write(struct.pack("<BH", REGISTER_NAMES.index(reg), val))
+
+    out.write(struct.pack("<H", len(preset_mem)))
+    for addr, val in preset_mem.items():
+        out.write(struct.pack("<HB", addr, val))
+
+    for reg in REGISTER_NAMES:
+        out.write(struct.pack("<H", expected_regs.get(reg, 0)))
+
+    out.write(struct.pack("<H", len(checkpoints)))
+    for addr, val in checkpoints.items():
+        out.write(struct.pack("<HB", addr, val))
+
+    for seqs in (read_seqs, write_seqs):
+        out.write(struct.pack("<B", len(seqs)))
+        for port, seq in seqs.items():
+            assert port <= 0xff, f"{desc}: port {port:#x} out of range"
+            out.write(struct.pack("<BH", port, len(seq)))
+            out.write(bytes(seq))
+
+
+def main() -> int:
+    if len(sys.argv) != 2:
+        print(f"usage: {sys.argv[0]} <output-file>", file=sys.stderr)
+        return 1
+
+    with open(INSTRUCTIONS) as fin:
+        tests = yaml.load(fin, yaml.Loader)
+
+    cases = [test for test in tests["tests"] if "skip" not in test]
+
+    out = BytesIO()
+    out.write(b"Z80B")
+    out.write(struct.pack("<BI", 1, len(cases)))
+    for test in cases:
+        pack_case(out, test)
+
+    with open(sys.argv[1], "wb") as fout:
+        fout.write(out.getvalue())
+
+    print(f"packed {len(cases)} cases into {sys.argv[1]}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,181 @@
+/* Z80e throughput benchmark.
+ *
+ * Runs a set of looping corpora (ALU soak, LDIR block copy, tight DJNZ
+ * loops, DD/FD CB prefix storm) against the core for a fixed wall-clock
+ * interval each, in both the flat-memory and the callback memory modes, and
+ * reports instructions/sec and emulated MHz per corpus.
+ *
+ * Usage: `./z80bench [--json] [--seconds=<float>]`. The default interval is
+ * 1 second per corpus per mode; `--json` emits one machine-readable record
+ * per measurement for tracking across commits.
+ *
+ * Note that in flat mode a repeating block instruction (LDIR) is executed
+ * to completion as one z80e_instruction call, so the instructions/sec of
+ * the ldir corpus counts repeats in cycles, not in instructions.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <z80/emulator.h>
+
+/* Re-check the clock once per this many instructions */
+#define CLOCK_CHECK_PERIOD 4096
+
+typedef struct {
+  char const* name;
+  uint8_t const* program;
+  uint16_t len;
+} corpus;
+
+/* clang-format off */
+
+/* ld a/b/c, then add/adc/sub/sbc/and/or/xor/cp/inc/dec soak, jp 0 */
+static uint8_t const prog_alu[] = {
+    0x3E, 0x9A, 0x06, 0x77, 0x80, 0x88, 0x90, 0x98, 0xA0, 0xB0, 0xA8, 0xB8,
+    0x3C, 0x3D, 0x0E, 0x12, 0x81, 0x89, 0x91, 0x99, 0xC3, 0x00, 0x00,
+};
+
+/* ld hl,4000h; ld de,8000h; ld bc,1000h; ldir; jp 0 */
+static uint8_t const prog_ldir[] = {
+    0x21, 0x00, 0x40, 0x11, 0x00, 0x80, 0x01, 0x00, 0x10, 0xED, 0xB0, 0xC3, 0x00, 0x00,
+};
+
+/* ld b,0ffh; djnz $; jp 0 */
+static uint8_t const prog_djnz[] = {
+    0x06, 0xFF, 0x10, 0xFE, 0xC3, 0x00, 0x00,
+};
+
+/* ld ix,6000h; ld iy,7000h; set/rlc/rl/sla on (ix+d)/(iy+d); jp 8 */
+static uint8_t const prog_ddcb[] = {
+    0xDD, 0x21, 0x00, 0x60, 0xFD, 0x21, 0x00, 0x70,
+    0xDD, 0xCB, 0x01, 0xC6, 0xDD, 0xCB, 0x02, 0x06,
+    0xDD, 0xCB, 0x03, 0x16, 0xFD, 0xCB, 0x04, 0x26,
+    0xC3, 0x08, 0x00,
+};
+
+static corpus const corpora[] = {
+    {"alu", prog_alu, sizeof(prog_alu)},
+    {"ldir", prog_ldir, sizeof(prog_ldir)},
+    {"djnz", prog_djnz, sizeof(prog_djnz)},
+    {"ddcb", prog_ddcb, sizeof(prog_ddcb)},
+};
+/* clang-format on */
+
+static uint8_t mem[0x10000];
+
+static uint8_t memread(uint32_t addr, void* ctx) { return mem[addr & 0xffff]; }
+static void memwrite(uint32_t addr, uint8_t byte, void* ctx) { mem[addr & 0xffff] = byte; }
+static uint8_t ioread(uint16_t addr, uint8_t byte, void* ctx) { return 0; }
+static void iowrite(uint16_t addr, uint8_t byte, void* ctx) {}
+
+#ifdef Z80E_PROFILE
+static void print_top_opcodes(z80e* z80) {
+  for (int rank = 0; rank < 5; ++rank) {
+    uint32_t best = 0;
+    int best_op = -1;
+    for (int op = 0; op < 256; ++op) {
+      if (z80->profile.opcode[op] > best) {
+        best = z80->profile.opcode[op];
+        best_op = op;
+      }
+    }
+    if (best_op < 0) {
+      break;
+    }
+    printf("        opcode 0x%02x: %u\n", best_op, best);
+    z80->profile.opcode[best_op] = 0;
+  }
+}
+#endif
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int bench_corpus(corpus const* c, int flat, double seconds, int json) {
+  memset(mem, 0, sizeof(mem));
+  memcpy(mem, c->program, c->len);
+
+  z80e_config cfg = {
+      .memread = memread,
+      .memwrite = memwrite,
+      .ioread = ioread,
+      .iowrite = iowrite,
+      .mem = flat ? mem : 0,
+  };
+  z80e z80;
+  z80e_init(&z80, &cfg);
+
+  uint64_t instructions = 0;
+  uint64_t cycles = 0;
+
+  double start = now();
+  double elapsed;
+  for (;;) {
+    for (int i = 0; i < CLOCK_CHECK_PERIOD; ++i) {
+      zi32 t = z80e_instruction(&z80);
+      if (t < 0) {
+        fprintf(stderr, "%s: error %i at 0x%04x\n", c->name, z80.error, z80.reg.pc);
+        return 1;
+      }
+      cycles += (uint64_t)t;
+    }
+    instructions += CLOCK_CHECK_PERIOD;
+    elapsed = now() - start;
+    if (elapsed >= seconds) {
+      break;
+    }
+  }
+
+  char const* mode = flat ? "flat" : "callback";
+  double ips = instructions / elapsed;
+  double mhz = cycles / elapsed / 1e6;
+  if (json) {
+    printf("{\"corpus\": \"%s\", \"mode\": \"%s\", \"instructions\": %llu, \"cycles\": %llu, "
+           "\"seconds\": %.6f, \"instructions_per_sec\": %.0f, \"emulated_mhz\": %.3f}\n",
+           c->name, mode, (unsigned long long)instructions, (unsigned long long)cycles, elapsed, ips, mhz);
+  } else {
+    printf("%-5s %-8s %12.0f instr/s %10.1f emulated MHz\n", c->name, mode, ips, mhz);
+#ifdef Z80E_PROFILE
+    print_top_opcodes(&z80);
+#endif
+  }
+
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  int json = 0;
+  double seconds = 1.0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--json") == 0) {
+      json = 1;
+    } else if (strncmp(argv[i], "--seconds=", 10) == 0) {
+      seconds = strtod(argv[i] + 10, NULL);
+      if (seconds <= 0) {
+        fprintf(stderr, "invalid interval: %s\n", argv[i] + 10);
+        return EXIT_FAILURE;
+      }
+    } else {
+      fprintf(stderr, "usage: %s [--json] [--seconds=<float>]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  for (unsigned i = 0; i < sizeof(corpora) / sizeof(corpora[0]); ++i) {
+    for (int flat = 0; flat < 2; ++flat) {
+      if (bench_corpus(&corpora[i], flat, seconds, json) != 0) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,329 @@
+/* Z80e bulk test runner.
+ *
+ * Runs a batch of pre-compiled test cases packed by pack_cases.py from
+ * tests/instructions.yaml: `./z80btest instructions.bin`. Every case is
+ * executed in-process against z80e_instruction, so the whole suite is one
+ * exec with no interpreter round trips. Mismatches are printed per case and
+ * the exit status is non-zero if any case failed.
+ *
+ * See pack_cases.py for the batch file format.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <z80/emulator.h>
+
+#define REGISTER_COUNT 23
+#define MAX_PORTS 8
+#define MAX_STEPS 10000000
+
+/* Indices match REGISTER_NAMES in pack_cases.py */
+static char const* const register_names[REGISTER_COUNT] = {
+    "a", "b", "c", "d", "e", "h", "l", "f",
+    "a_alt", "b_alt", "c_alt", "d_alt", "e_alt", "h_alt", "l_alt", "f_alt",
+    "i", "r", "ix", "iy", "sp", "pc", "u",
+};
+
+typedef struct {
+  uint8_t port;
+  uint16_t len;
+  uint16_t pos;
+  uint8_t const* bytes;
+} io_sequence;
+
+typedef struct {
+  char const* desc;
+  uint16_t desc_len;
+
+  io_sequence reads[MAX_PORTS]; /*< Served to the CPU on port reads */
+  uint8_t read_count;
+  io_sequence writes[MAX_PORTS]; /*< Asserted against port writes */
+  uint8_t write_count;
+
+  int failed;
+} test_case;
+
+static uint8_t mem[0x10000];
+
+uint8_t memread(uint32_t addr, void* ctx);
+void memwrite(uint32_t addr, uint8_t byte, void* ctx);
+uint8_t ioread(uint16_t addr, uint8_t byte, void* ctx);
+void iowrite(uint16_t addr, uint8_t byte, void* ctx);
+
+uint8_t* read_file(char const* filename, size_t* size);
+void set_register(z80e* z80, uint8_t id, uint16_t val);
+uint16_t get_register(z80e* z80, uint8_t id);
+void fail(test_case* tc, char const* fmt, ...);
+
+static uint16_t read_u16(uint8_t const* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <batch-file>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  size_t size;
+  uint8_t* batch = read_file(argv[1], &size);
+  if (batch == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  if (size < 9 || memcmp(batch, "Z80B", 4) != 0 || batch[4] != 1) {
+    fprintf(stderr, "%s: not a version 1 batch file\n", argv[1]);
+    free(batch);
+    return EXIT_FAILURE;
+  }
+
+  uint32_t count = batch[5] | (batch[6] << 8) | ((uint32_t)batch[7] << 16) | ((uint32_t)batch[8] << 24);
+  uint8_t const* p = batch + 9;
+
+  uint32_t failed_count = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    test_case tc = {0};
+
+    tc.desc_len = read_u16(p);
+    tc.desc = (char const*)(p + 2);
+    p += 2 + tc.desc_len;
+
+    uint16_t prog_len = read_u16(p);
+    p += 2;
+    memset(mem, 0, sizeof(mem));
+    memcpy(mem, p, prog_len);
+    p += prog_len;
+
+    z80e_config cfg = {
+        .memread = memread,
+        .memwrite = memwrite,
+        .ioread = ioread,
+        .iowrite = iowrite,
+        .ctx = &tc,
+    };
+    z80e z80;
+    z80e_init(&z80, &cfg);
+
+    uint8_t preset_reg_count = *p++;
+    for (uint8_t j = 0; j < preset_reg_count; ++j) {
+      set_register(&z80, p[0], read_u16(p + 1));
+      p += 3;
+    }
+
+    uint16_t preset_mem_count = read_u16(p);
+    p += 2;
+    for (uint16_t j = 0; j < preset_mem_count; ++j) {
+      mem[read_u16(p)] = p[2];
+      p += 3;
+    }
+
+    uint8_t const* expected_regs = p;
+    p += 2 * REGISTER_COUNT;
+
+    uint16_t checkpoint_count = read_u16(p);
+    uint8_t const* checkpoints = p + 2;
+    p += 2 + 3 * checkpoint_count;
+
+    for (int dir = 0; dir < 2; ++dir) {
+      io_sequence* seqs = dir == 0 ? tc.reads : tc.writes;
+      uint8_t seq_count = *p++;
+      if (seq_count > MAX_PORTS) {
+        fprintf(stderr, "case %u: too many IO ports\n", i);
+        free(batch);
+        return EXIT_FAILURE;
+      }
+      for (uint8_t j = 0; j < seq_count; ++j) {
+        seqs[j].port = p[0];
+        seqs[j].len = read_u16(p + 1);
+        seqs[j].bytes = p + 3;
+        p += 3 + seqs[j].len;
+      }
+      *(dir == 0 ? &tc.read_count : &tc.write_count) = seq_count;
+    }
+
+    long steps = 0;
+    while (!z80e_get_halt(&z80)) {
+      if (steps++ == MAX_STEPS) {
+        fail(&tc, "did not halt after %i instructions", MAX_STEPS);
+        break;
+      }
+      if (z80e_instruction(&z80) < 0) {
+        fail(&tc, "error %i at 0x%04x", z80.error, z80.reg.pc);
+        break;
+      }
+    }
+
+    for (uint8_t j = 0; j < REGISTER_COUNT; ++j) {
+      uint16_t expected = read_u16(expected_regs + 2 * j);
+      uint16_t actual = get_register(&z80, j);
+      if (actual != expected) {
+        fail(&tc, "register %s expected 0x%04x, got 0x%04x", register_names[j], expected, actual);
+      }
+    }
+
+    for (uint16_t j = 0; j < checkpoint_count; ++j) {
+      uint16_t addr = read_u16(checkpoints + 3 * j);
+      uint8_t expected = checkpoints[3 * j + 2];
+      if (mem[addr] != expected) {
+        fail(&tc, "at 0x%04x: expected 0x%02x, got 0x%02x", addr, expected, mem[addr]);
+      }
+    }
+
+    for (uint8_t j = 0; j < tc.read_count; ++j) {
+      if (tc.reads[j].pos < tc.reads[j].len) {
+        fail(&tc, "port 0x%02x: %i input bytes left", tc.reads[j].port, tc.reads[j].len - tc.reads[j].pos);
+      }
+    }
+    for (uint8_t j = 0; j < tc.write_count; ++j) {
+      if (tc.writes[j].pos < tc.writes[j].len) {
+        fail(&tc, "port 0x%02x: %i output bytes left", tc.writes[j].port, tc.writes[j].len - tc.writes[j].pos);
+      }
+    }
+
+    failed_count += tc.failed;
+  }
+
+  printf("%u cases, %u failed\n", count, failed_count);
+
+  free(batch);
+  return failed_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+uint8_t memread(uint32_t addr, void* ctx) { return mem[addr & 0xffff]; }
+
+void memwrite(uint32_t addr, uint8_t byte, void* ctx) { mem[addr & 0xffff] = byte; }
+
+uint8_t ioread(uint16_t addr, uint8_t byte, void* ctx) {
+  test_case* tc = ctx;
+  uint8_t port = addr & 0xff;
+  for (uint8_t j = 0; j < tc->read_count; ++j) {
+    io_sequence* seq = &tc->reads[j];
+    if (seq->port != port) {
+      continue;
+    }
+    if (seq->pos == seq->len) {
+      fail(tc, "port 0x%02x: read past the end of the input sequence", port);
+      return 0;
+    }
+    return seq->bytes[seq->pos++];
+  }
+  fail(tc, "port 0x%02x: unexpected read", port);
+  return 0;
+}
+
+void iowrite(uint16_t addr, uint8_t byte, void* ctx) {
+  test_case* tc = ctx;
+  uint8_t port = addr & 0xff;
+  for (uint8_t j = 0; j < tc->write_count; ++j) {
+    io_sequence* seq = &tc->writes[j];
+    if (seq->port != port) {
+      continue;
+    }
+    if (seq->pos == seq->len) {
+      fail(tc, "port 0x%02x: write past the end of the output sequence", port);
+      return;
+    }
+    if (byte != seq->bytes[seq->pos]) {
+      fail(tc, "port 0x%02x: at %i: expected 0x%02x, got 0x%02x", port, seq->pos, seq->bytes[seq->pos], byte);
+    }
+    ++seq->pos;
+    return;
+  }
+  fail(tc, "port 0x%02x: unexpected write", port);
+}
+
+uint8_t* read_file(char const* filename, size_t* size) {
+  FILE* file = fopen(filename, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "cannot open file %s\n", filename);
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long len = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  uint8_t* buf = malloc(len);
+  if (buf == NULL || fread(buf, 1, len, file) != (size_t)len) {
+    fprintf(stderr, "cannot read file %s\n", filename);
+    free(buf);
+    fclose(file);
+    return NULL;
+  }
+
+  fclose(file);
+  *size = len;
+  return buf;
+}
+
+void set_register(z80e* z80, uint8_t id, uint16_t val) {
+  switch (id) {
+  case 0: z80->reg.main.a = val; break;
+  case 1: z80->reg.main.b = val; break;
+  case 2: z80->reg.main.c = val; break;
+  case 3: z80->reg.main.d = val; break;
+  case 4: z80->reg.main.e = val; break;
+  case 5: z80->reg.main.h = val; break;
+  case 6: z80->reg.main.l = val; break;
+  case 7: z80->reg.main.f = val; break;
+  case 8: z80->reg.alt.a = val; break;
+  case 9: z80->reg.alt.b = val; break;
+  case 10: z80->reg.alt.c = val; break;
+  case 11: z80->reg.alt.d = val; break;
+  case 12: z80->reg.alt.e = val; break;
+  case 13: z80->reg.alt.h = val; break;
+  case 14: z80->reg.alt.l = val; break;
+  case 15: z80->reg.alt.f = val; break;
+  case 16: z80->reg.i = val; break;
+  case 17: z80->reg.r = val; break;
+  case 18: z80->reg.ix = val; break;
+  case 19: z80->reg.iy = val; break;
+  case 20: z80->reg.sp = val; break;
+  case 21: z80->reg.pc = val; break;
+  case 22: z80->reg.u = val; break;
+  }
+}
+
+void fail(test_case* tc, char const* fmt, ...) {
+  if (!tc->failed) {
+    printf("FAIL %.*s\n", tc->desc_len, tc->desc);
+    tc->failed = 1;
+  }
+  printf("  ");
+  va_list args;
+  va_start(args, fmt);
+  vprintf(fmt, args);
+  va_end(args);
+  printf("\n");
+}
+
+uint16_t get_register(z80e* z80, uint8_t id) {
+  switch (id) {
+  case 0: return z80->reg.main.a;
+  case 1: return z80->reg.main.b;
+  case 2: return z80->reg.main.c;
+  case 3: return z80->reg.main.d;
+  case 4: return z80->reg.main.e;
+  case 5: return z80->reg.main.h;
+  case 6: return z80->reg.main.l;
+  case 7: return z80->reg.main.f;
+  case 8: return z80->reg.alt.a;
+  case 9: return z80->reg.alt.b;
+  case 10: return z80->reg.alt.c;
+  case 11: return z80->reg.alt.d;
+  case 12: return z80->reg.alt.e;
+  case 13: return z80->reg.alt.h;
+  case 14: return z80->reg.alt.l;
+  case 15: return z80->reg.alt.f;
+  case 16: return z80->reg.i;
+  case 17: return z80->reg.r;
+  case 18: return z80->reg.ix;
+  case 19: return z80->reg.iy;
+  case 20: return z80->reg.sp;
+  case 21: return z80->reg.pc;
+  case 22: return z80->reg.u;
+  }
+  return 0;
+}
@@ -0,0 +1,271 @@
+/* Z80e differential fuzzer.
+ *
+ * Instantiates the core in its variant configurations - callback memory,
+ * flat memory (with batched block instructions) and callback memory with
+ * the predecode cache - feeds all of them identical random instruction
+ * streams and register presets, steps them in lockstep and reports the
+ * first diverging {registers, memory, IO} state. Seeds are distributed
+ * across a thread pool, so a run covers billions of comparative
+ * instructions per minute and optimization work (flag tables, predecode,
+ * computed goto, LDIR batching) can be accepted without silent
+ * architectural regressions that tests/instructions.yaml is too coarse to
+ * catch.
+ *
+ * Usage: `./z80fuzz [--seeds=<n>] [--steps=<n>] [--threads=<n>]`. The
+ * default is 1000 seeds of 10000 instructions each on all online cores.
+ * Exits nonzero on the first divergence, printing the seed so the case can
+ * be re-run alone.
+ *
+ * In flat mode a repeating block instruction executes to completion as one
+ * z80e_instruction call, so the variants are synchronized on the T-state
+ * counter, not on call counts, and compared at common boundaries.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <z80/emulator.h>
+
+#define VARIANT_COUNT 3
+
+static char const* const variant_names[VARIANT_COUNT] = {"callback", "flat", "predecode"};
+
+typedef struct {
+  uint8_t mem[0x10000];
+  uint64_t iosum;
+  uint32_t seed;
+} core_ctx;
+
+typedef struct {
+  z80e z80;
+  core_ctx ctx;
+} core;
+
+static uint32_t xorshift32(uint32_t* s) {
+  uint32_t x = *s;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *s = x;
+}
+
+static uint8_t memread(uint32_t addr, void* ctx) { return ((core_ctx*)ctx)->mem[addr & 0xffff]; }
+static void memwrite(uint32_t addr, uint8_t byte, void* ctx) { ((core_ctx*)ctx)->mem[addr & 0xffff] = byte; }
+
+/* IO reads must be identical across the variants, so the value is a pure
+ * function of the seed and the port - no shared stream position. */
+static uint8_t ioread(uint16_t addr, uint8_t byte, void* ctx) {
+  uint32_t s = ((core_ctx*)ctx)->seed ^ (uint32_t)(addr << 8) ^ byte ^ 0x9e3779b9u;
+  return xorshift32(&s);
+}
+
+static void iowrite(uint16_t addr, uint8_t byte, void* ctx) {
+  core_ctx* c = ctx;
+  c->iosum = c->iosum * 31 + (uint64_t)(addr ^ byte);
+}
+
+static void setup_core(core* c, uint32_t seed, int flat, int predecode) {
+  uint32_t s = seed;
+
+  for (uint32_t i = 0; i < 0x10000; ++i) {
+    c->ctx.mem[i] = xorshift32(&s);
+  }
+  c->ctx.iosum = 0;
+  c->ctx.seed = seed;
+
+  z80e_config cfg = {
+      .memread = memread,
+      .memwrite = memwrite,
+      .ioread = ioread,
+      .iowrite = iowrite,
+      .ctx = &c->ctx,
+      .mem = flat ? c->ctx.mem : 0,
+      .predecode = predecode,
+  };
+  z80e_init(&c->z80, &cfg);
+
+  c->z80.reg.main.af = xorshift32(&s);
+  c->z80.reg.main.bc = xorshift32(&s);
+  c->z80.reg.main.de = xorshift32(&s);
+  c->z80.reg.main.hl = xorshift32(&s);
+  c->z80.reg.alt.af = xorshift32(&s);
+  c->z80.reg.alt.bc = xorshift32(&s);
+  c->z80.reg.alt.de = xorshift32(&s);
+  c->z80.reg.alt.hl = xorshift32(&s);
+  c->z80.reg.ix = xorshift32(&s);
+  c->z80.reg.iy = xorshift32(&s);
+  c->z80.reg.sp = xorshift32(&s);
+  c->z80.reg.pc = 0;
+}
+
+static int regs_equal(z80e const* a, z80e const* b) {
+  return a->reg.main.af == b->reg.main.af && a->reg.main.bc == b->reg.main.bc && a->reg.main.de == b->reg.main.de &&
+         a->reg.main.hl == b->reg.main.hl && a->reg.alt.af == b->reg.alt.af && a->reg.alt.bc == b->reg.alt.bc &&
+         a->reg.alt.de == b->reg.alt.de && a->reg.alt.hl == b->reg.alt.hl && a->reg.ix == b->reg.ix &&
+         a->reg.iy == b->reg.iy && a->reg.sp == b->reg.sp && a->reg.pc == b->reg.pc && a->reg.i == b->reg.i &&
+         a->reg.u == b->reg.u && a->cur_reg_set == b->cur_reg_set && a->halt == b->halt && a->iff == b->iff &&
+         a->int_mode == b->int_mode && a->error == b->error && a->tstates == b->tstates;
+}
+
+static void print_state(char const* name, z80e const* z) {
+  printf("    %-9s af=%04x bc=%04x de=%04x hl=%04x ix=%04x iy=%04x sp=%04x pc=%04x "
+         "halt=%d err=%d tstates=%llu\n",
+         name, z->reg.main.af, z->reg.main.bc, z->reg.main.de, z->reg.main.hl, z->reg.ix, z->reg.iy, z->reg.sp,
+         z->reg.pc, z->halt, z->error, (unsigned long long)z->tstates);
+}
+
+/* Advance every variant to the highest T-state counter among them. Stalled
+ * cores (latched error) are left where they are and caught by the state
+ * comparison. */
+static void sync_cores(core* cores) {
+  for (;;) {
+    uint64_t target = 0;
+    int progressed = 0;
+
+    for (int v = 0; v < VARIANT_COUNT; ++v) {
+      if (cores[v].z80.tstates > target) {
+        target = cores[v].z80.tstates;
+      }
+    }
+    for (int v = 0; v < VARIANT_COUNT; ++v) {
+      while (!cores[v].z80.error && cores[v].z80.tstates < target) {
+        z80e_instruction(&cores[v].z80);
+        progressed = 1;
+      }
+    }
+    if (!progressed) {
+      return;
+    }
+  }
+}
+
+/* Runs one seed on all variants; returns 0 when they agree to the end */
+static int run_seed(uint32_t seed, uint32_t steps) {
+  static _Thread_local core cores[VARIANT_COUNT];
+  int divergence = 0;
+
+  setup_core(&cores[0], seed, 0, 0);
+  setup_core(&cores[1], seed, 1, 0);
+  setup_core(&cores[2], seed, 0, 1);
+
+  for (uint32_t step = 0; step < steps && !divergence; ++step) {
+    z80e_instruction(&cores[0].z80);
+    sync_cores(cores);
+
+    /* An erroring instruction consumes no T-states, so the peers stopped
+     * just short of it; have them execute it too before comparing */
+    if (cores[0].z80.error) {
+      for (int v = 1; v < VARIANT_COUNT; ++v) {
+        if (!cores[v].z80.error) {
+          z80e_instruction(&cores[v].z80);
+        }
+      }
+    }
+
+    for (int v = 1; v < VARIANT_COUNT; ++v) {
+      if (!regs_equal(&cores[0].z80, &cores[v].z80)) {
+        printf("FAIL seed=%u step=%u: %s diverged from %s\n", seed, step, variant_names[v], variant_names[0]);
+        print_state(variant_names[0], &cores[0].z80);
+        print_state(variant_names[v], &cores[v].z80);
+        divergence = 1;
+      }
+    }
+    if (cores[0].z80.halt || cores[0].z80.error) {
+      break;
+    }
+  }
+
+  for (int v = 1; v < VARIANT_COUNT; ++v) {
+    if (cores[0].ctx.iosum != cores[v].ctx.iosum) {
+      printf("FAIL seed=%u: %s IO write stream diverged\n", seed, variant_names[v]);
+      divergence = 1;
+    }
+    if (memcmp(cores[0].ctx.mem, cores[v].ctx.mem, sizeof(cores[0].ctx.mem)) != 0) {
+      for (uint32_t a = 0; a < 0x10000; ++a) {
+        if (cores[0].ctx.mem[a] != cores[v].ctx.mem[a]) {
+          printf("FAIL seed=%u: %s memory diverged at %04x: %02x != %02x\n", seed, variant_names[v], a,
+                 cores[v].ctx.mem[a], cores[0].ctx.mem[a]);
+          break;
+        }
+      }
+      divergence = 1;
+    }
+  }
+  return divergence;
+}
+
+typedef struct {
+  uint32_t seeds;
+  uint32_t steps;
+  uint32_t next;
+  int failed;
+  pthread_mutex_t lock;
+} fuzz_ctx;
+
+static void* fuzz_worker(void* arg) {
+  fuzz_ctx* ctx = arg;
+
+  for (;;) {
+    uint32_t seed;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->failed || ctx->next >= ctx->seeds) {
+      pthread_mutex_unlock(&ctx->lock);
+      return 0;
+    }
+    seed = ++ctx->next; /* seed 0 would zero the xorshift state */
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (run_seed(seed, ctx->steps)) {
+      pthread_mutex_lock(&ctx->lock);
+      ctx->failed = 1;
+      pthread_mutex_unlock(&ctx->lock);
+      return 0;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  fuzz_ctx ctx = {.seeds = 1000, .steps = 10000, .next = 0, .failed = 0};
+  long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+  pthread_t threads[64];
+
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], "--seeds=", 8) == 0) {
+      ctx.seeds = strtoul(argv[i] + 8, 0, 10);
+    } else if (strncmp(argv[i], "--steps=", 8) == 0) {
+      ctx.steps = strtoul(argv[i] + 8, 0, 10);
+    } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+      nthreads = strtol(argv[i] + 10, 0, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--seeds=<n>] [--steps=<n>] [--threads=<n>]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (nthreads < 1) {
+    nthreads = 1;
+  }
+  if (nthreads > 64) {
+    nthreads = 64;
+  }
+
+  pthread_mutex_init(&ctx.lock, 0);
+  for (long i = 1; i < nthreads; ++i) {
+    pthread_create(&threads[i], 0, fuzz_worker, &ctx);
+  }
+  fuzz_worker(&ctx);
+  for (long i = 1; i < nthreads; ++i) {
+    pthread_join(threads[i], 0);
+  }
+  pthread_mutex_destroy(&ctx.lock);
+
+  if (ctx.failed) {
+    return 1;
+  }
+  printf("ok: %u seeds x %u steps, %d variants, %ld threads\n", ctx.seeds, ctx.steps, VARIANT_COUNT, nthreads);
+  return 0;
+}
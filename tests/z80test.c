@@ -16,22 +16,28 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <z80/emulator.h>
 
 #include "utils/linkedlist.h"
 
+#define ADDR_SPACE_SIZE 0x10000
+
 typedef struct {
   z80e* z80;
   linkedlist* dump_points;
   char const* mem_filename;
   char const* io_filename;
-  FILE* memfile;
-  FILE* iofile;
+  uint8_t* mem; /*< mmap'ed memory file */
+  uint8_t* io;  /*< mmap'ed io file */
 } program_context;
 
 void memwrite(uint32_t addr, uint8_t byte, void* ctx);
@@ -43,6 +49,8 @@ int startswith(char const* s1, char const* s2);
 int parse_args(program_context* ctx, int argc, char** argv);
 void print_usage(FILE* file);
 
+uint8_t* map_file(char const* filename);
+
 char* alloc_binfmt_buffer(int max_bits);
 char const* binfmt(uint32_t v, int width, char* buf);
 void register_dump(z80e* z80);
@@ -72,15 +80,13 @@ int main(int argc, char* argv[]) {
     goto cleanup;
   }
 
-  if ((progctx.memfile = fopen(progctx.mem_filename, "rb+")) == NULL) {
-    fprintf(stderr, "cannot open file %s: %s\n", progctx.mem_filename, strerror(errno));
+  if ((progctx.mem = map_file(progctx.mem_filename)) == NULL) {
     ret = EXIT_FAILURE;
     goto cleanup;
   }
 
-  if ((progctx.iofile = fopen(progctx.io_filename, "rb+")) == NULL) {
-    fprintf(stderr, "cannot open file %s: %s\n", progctx.io_filename, strerror(errno));
-    free(progctx.memfile);
+  if ((progctx.io = map_file(progctx.io_filename)) == NULL) {
+    munmap(progctx.mem, ADDR_SPACE_SIZE);
     ret = EXIT_FAILURE;
     goto cleanup;
   }
@@ -91,20 +97,24 @@ int main(int argc, char* argv[]) {
       ll_pop_front_discard(progctx.dump_points);
       register_dump(&z80);
       printf("\n");
+      msync(progctx.mem, ADDR_SPACE_SIZE, MS_SYNC);
+      msync(progctx.io, ADDR_SPACE_SIZE, MS_SYNC);
     }
 
     if (z80e_instruction(&z80) == Z80E_INVALID_OPCODE) {
       fprintf(stderr, "at 0x%04x: invalid instruction opcode\n", z80.reg.pc);
       ret = EXIT_FAILURE;
-      goto cleanup_fds;
+      goto cleanup_maps;
     }
   }
 
   register_dump(&z80);
 
-cleanup_fds:
-  fclose(progctx.memfile);
-  fclose(progctx.iofile);
+cleanup_maps:
+  msync(progctx.mem, ADDR_SPACE_SIZE, MS_SYNC);
+  msync(progctx.io, ADDR_SPACE_SIZE, MS_SYNC);
+  munmap(progctx.mem, ADDR_SPACE_SIZE);
+  munmap(progctx.io, ADDR_SPACE_SIZE);
 
 cleanup:
   ll_destroy(progctx.dump_points);
@@ -112,36 +122,58 @@ cleanup:
   return ret;
 }
 
+/* Map `filename` shared and writable, so the callbacks are plain pointer
+ * dereferences instead of an fseek+fread syscall pair per emulated access.
+ * Files shorter than the 64 kB address space are grown, which matches the
+ * old stdio behavior of writes past the end extending the file. */
+uint8_t* map_file(char const* filename) {
+  int fd = open(filename, O_RDWR);
+  if (fd < 0) {
+    fprintf(stderr, "cannot open file %s: %s\n", filename, strerror(errno));
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    fprintf(stderr, "cannot stat file %s: %s\n", filename, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+
+  if (st.st_size < ADDR_SPACE_SIZE && ftruncate(fd, ADDR_SPACE_SIZE) != 0) {
+    fprintf(stderr, "cannot grow file %s to 64kB: %s\n", filename, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+
+  void* map = mmap(NULL, ADDR_SPACE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd); /* the mapping keeps the file referenced */
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "cannot mmap file %s: %s\n", filename, strerror(errno));
+    return NULL;
+  }
+
+  return map;
+}
+
 void memwrite(uint32_t addr, uint8_t byte, void* ctx) {
   program_context* c = ctx;
-  uint8_t buf[1];
-  buf[0] = byte;
-  fseek(c->memfile, addr, SEEK_SET);
-  fwrite(buf, 1, 1, c->memfile);
+  c->mem[addr & 0xffff] = byte;
 }
 
 uint8_t memread(uint32_t addr, void* ctx) {
   program_context* c = ctx;
-  uint8_t buf[1];
-  fseek(c->memfile, addr, SEEK_SET);
-  fread(buf, 1, 1, c->memfile);
-  return buf[0];
+  return c->mem[addr & 0xffff];
 }
 
 void iowrite(uint16_t addr, uint8_t byte, void* ctx) {
   program_context* c = ctx;
-  uint8_t buf[1];
-  buf[0] = byte;
-  fseek(c->iofile, addr, SEEK_SET);
-  fwrite(buf, 1, 1, c->iofile);
+  c->io[addr] = byte;
 }
 
 uint8_t ioread(uint16_t addr, uint8_t byte, void* ctx) {
   program_context* c = ctx;
-  uint8_t buf[1];
-  fseek(c->iofile, addr, SEEK_SET);
-  fread(buf, 1, 1, c->iofile);
-  return buf[0];
+  return c->io[addr];
 }
 
 int startswith(char const* s1, char const* s2) {